@@ -9,6 +9,7 @@ hpcrun_events_array=( CPUTIME )
 # Note: would like to use the below events, but they all require elevated privileges, MPI strongly suggests against that, and I agree.
 # Alternatively, can set kernel.perf_event_paranoid=1, which also requires root privileges, and I'd like to avoid it. (https://superuser.com/questions/980632/run-perf-without-root-rights)
 # perf::CACHE-MISSES PAPI_L1_DCM PAPI_L2_DCM PAPI_L3_DCM PAPI_FP_OPS PAPI_LD_INS PAPI_SR_INS CPUTIME
+# The miniapp's own -H flag counts cycles, instructions, cache misses and dTLB misses per phase without privileges instead.
 
 # Miniapp settings
 miniapp=../../miniapp/miniapp.exe
@@ -0,0 +1,278 @@
+// Header-only C++ core of the miniapp's local distributed array operations.
+//
+// distributed_array<T, IterationOrder, Layout> is a view of one rank's local
+// portion of a distributed array. The element type, the order the local
+// elements are visited in and the memory layout are all template parameters,
+// so every configuration compiles to its own fully inlined loops, with no
+// runtime checks on the order or layout inside them.
+//
+// The operations work on a range [begin, end) of positions in the iteration
+// order. Handing out ranges across threads (and all MPI communication) is left
+// to the caller, see distributed_array_core.h for the C interface.
+#ifndef MINIAPP_DISTRIBUTED_ARRAY_HPP
+#define MINIAPP_DISTRIBUTED_ARRAY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace miniapp {
+
+// Same semantics as the C side's max2/min2 macros (and vectorizable, unlike std::fmax)
+template< typename T > inline T max2( T a, T b ){ return ( a < b ) ? b : a; }
+template< typename T > inline T min2( T a, T b ){ return ( a < b ) ? a : b; }
+
+// Element types
+
+// bfloat16: the upper half of an IEEE float (8 exponent bits, 7 mantissa bits)
+// Only a storage type, arithmetic is done in float (see compute_type).
+struct bfloat16 {
+  std::uint16_t bits;
+
+  bfloat16() = default;
+  bfloat16( float value ) : bits( round( value ) ) {}
+
+  // \brief Bits of a float rounded to bfloat16, to nearest, ties to even
+  static inline std::uint16_t round( float value ){
+    std::uint32_t u;
+    std::memcpy( &u, &value, sizeof(u) );
+    const std::uint32_t rounded = ( u + 0x7fffu + ( ( u >> 16 ) & 1u ) ) >> 16;
+    const std::uint32_t quiet_nan = ( u >> 16 ) | 0x0040u;
+    // Note: a select rather than a branch, so conversion loops vectorize
+    return (std::uint16_t)( ( ( u & 0x7fffffffu ) > 0x7f800000u ) ? quiet_nan : rounded );
+  }
+
+  operator float() const {
+    const std::uint32_t u = (std::uint32_t) bits << 16;
+    float value;
+    std::memcpy( &value, &u, sizeof(value) );
+    return value;
+  }
+};
+
+// Type the stencil is computed in, for each element type
+template< typename T > struct compute_type { using type = T; };
+template<> struct compute_type< bfloat16 > { using type = float; };
+
+// \brief Store a computed value into an element
+// Note: bfloat16 writes its bits directly, as SIMD loops do not vectorize
+//       through a temporary of a class type.
+template< typename T >
+inline void store_element( T& element, const typename compute_type< T >::type value ){ element = value; }
+inline void store_element( bfloat16& element, const float value ){ element.bits = bfloat16::round( value ); }
+
+// Iteration orders
+
+// Visit local elements in ascending order
+struct direct_order {
+  using index_type = std::size_t;
+  static constexpr bool indirect = false;
+};
+
+// Visit local elements in the order given by an indirection array
+// \tparam Index element type of the indirection array
+template< typename Index >
+struct indirect_order {
+  using index_type = Index;
+  static constexpr bool indirect = true;
+};
+
+// Layouts
+
+// Compact layout: no ghost cells, the stencil is radius 1 and truncated at
+// both ends of the local array (the distributed stencil corrects the ends).
+struct compact_layout {
+  // \brief Stencil of one element
+  // \param array local array
+  // \param i local index of the element
+  // \param n_elts number of local elements
+  // \param radius stencil radius (always 1)
+  // \return updated value of element i, in the compute type
+  template< typename T, typename C = typename compute_type< T >::type >
+  static inline C stencil_element( const T* array, std::size_t i, std::size_t n_elts, std::size_t /* radius */ ){
+    const C low    = ( i == 0 )          ? C( array[i] ) : C( array[i-1] );
+    const C center = C( array[i] );
+    const C high   = ( i == n_elts - 1 ) ? C( array[i] ) : C( array[i+1] );
+    const C max_val = max2( low, max2( center, high ) );
+    const C min_val = min2( low, min2( center, high ) );
+    return max_val / ( 1 + std::fabs( min_val ) );
+  }
+
+  // Whether stencil_element tests for the ends at every element
+  static constexpr bool truncated = true;
+};
+
+// Ghost-cell layout: at least radius valid ghost cells on each side, so every
+// element reads its whole neighborhood.
+struct ghost_layout {
+  template< typename T, typename C = typename compute_type< T >::type >
+  static inline C stencil_element( const T* array, std::size_t i, std::size_t /* n_elts */, std::size_t radius ){
+    const T* window = array + i - radius;
+    C max_val = C( window[0] );
+    C min_val = C( window[0] );
+    for( std::size_t j = 1; j <= 2*radius; ++j ){
+      max_val = max2( max_val, C( window[j] ) );
+      min_val = min2( min_val, C( window[j] ) );
+    }
+    return max_val / ( 1 + std::fabs( min_val ) );
+  }
+
+  static constexpr bool truncated = false;
+};
+
+// Local portion of a distributed array
+// \tparam T element type (float, double, long double or bfloat16)
+// \tparam IterationOrder direct_order or indirect_order<Index>
+// \tparam Layout compact_layout or ghost_layout
+template< typename T, typename IterationOrder, typename Layout >
+class distributed_array {
+public:
+  using element_type = T;
+  using index_type = typename IterationOrder::index_type;
+  using compute_type = typename miniapp::compute_type< T >::type;
+  // Sums are accumulated in at least double precision, whatever the storage
+  using accumulate_type = typename std::conditional< ( sizeof(T) > sizeof(double) ), T, double >::type;
+
+  // \brief Widen a stored element to the accumulation type
+  static inline accumulate_type widen( const T value ){
+    return (accumulate_type)(compute_type) value;
+  }
+
+  T* local_array;                 // local index 0 of the array read
+  T* update_array;                // local index 0 of the array stencil updates are written to
+  std::size_t local_elts;         // number of local elements
+  std::size_t radius;             // stencil radius
+  std::size_t global_offset;      // global index of local index 0
+  std::size_t total_elts;         // number of elements across all ranks
+  const index_type* indices;      // indirection array (indirect orders only)
+  std::size_t prefetch_distance;  // positions ahead to prefetch (indirect orders only), 0 for none
+
+  // \brief Local index visited at a position of the iteration order
+  inline std::size_t index( std::size_t position ) const {
+    if constexpr ( IterationOrder::indirect ){
+      return indices[position];
+    } else {
+      return position;
+    }
+  }
+
+  // \brief Prefetch the elements visited prefetch_distance positions ahead
+  // \param position current position
+  // \param read_array array that will be read, or nullptr
+  // \param write_array array that will be written, or nullptr
+  inline void prefetch( std::size_t position, const T* read_array, const T* write_array ) const {
+    if constexpr ( IterationOrder::indirect ){
+      const std::size_t ahead = position + prefetch_distance;
+      if( prefetch_distance > 0 && ahead < local_elts ){
+        if( read_array  != nullptr ) __builtin_prefetch( read_array  + indices[ahead], 0 );
+        if( write_array != nullptr ) __builtin_prefetch( write_array + indices[ahead], 1 );
+      }
+    }
+  }
+
+  // \brief Initialize a range of positions with arbitrary values
+  // \param begin first position
+  // \param end one past the last position
+  void init( std::size_t begin, std::size_t end ){
+    T* const array = local_array;
+    #pragma omp simd
+    for( std::size_t position = begin; position < end; ++position ){
+      prefetch( position, nullptr, array );
+      const std::size_t i = index( position );
+      const double j = ( i + 1 ) + (double) global_offset;
+      store_element( array[i], (compute_type) std::sin( ( j / total_elts ) * 3.14159265358979323846 ) );
+    }
+  }
+
+  // \brief Stencil a range of positions
+  // Only elements with a local index in [valid_begin, valid_end) are updated,
+  // the others are skipped (their neighborhoods are not ready yet).
+  // \param begin first position
+  // \param end one past the last position
+  // \param valid_begin first local index to update
+  // \param valid_end one past the last local index to update
+  // \param accumulate_sum whether to sum the updated elements
+  // \return sum of the updated elements if accumulate_sum, otherwise 0
+  double stencil( std::size_t begin, std::size_t end, std::size_t valid_begin, std::size_t valid_end, const bool accumulate_sum ){
+    const T* const array = local_array;
+    T* const updates = update_array;
+    accumulate_type sum = 0;
+
+    if constexpr ( ! IterationOrder::indirect ){
+      // Positions are indices, so the valid range is just a narrower range
+      begin = ( begin > valid_begin ) ? begin : valid_begin;
+      end   = ( end   < valid_end   ) ? end   : valid_end;
+      if( begin >= end ) return 0.0;
+
+      if constexpr ( Layout::truncated ){
+        // Peel the ends of the local array out of the branch-free loop
+        if( begin == 0 ){
+          store_element( updates[0], Layout::stencil_element( array, 0, local_elts, radius ) );
+          if( accumulate_sum ) sum += widen( updates[0] );
+          begin += 1;
+        }
+        if( end == local_elts && begin < end ){
+          end -= 1;
+          store_element( updates[end], Layout::stencil_element( array, end, local_elts, radius ) );
+          if( accumulate_sum ) sum += widen( updates[end] );
+        }
+        if( accumulate_sum ){
+          #pragma omp simd reduction(+: sum)
+          for( std::size_t i = begin; i < end; ++i ){
+            store_element( updates[i], ghost_layout::stencil_element( array, i, local_elts, 1 ) );
+            sum += widen( updates[i] );
+          }
+        } else {
+          #pragma omp simd
+          for( std::size_t i = begin; i < end; ++i ){
+            store_element( updates[i], ghost_layout::stencil_element( array, i, local_elts, 1 ) );
+          }
+        }
+      } else {
+        if( accumulate_sum ){
+          #pragma omp simd reduction(+: sum)
+          for( std::size_t i = begin; i < end; ++i ){
+            store_element( updates[i], Layout::stencil_element( array, i, local_elts, radius ) );
+            sum += widen( updates[i] );
+          }
+        } else {
+          #pragma omp simd
+          for( std::size_t i = begin; i < end; ++i ){
+            store_element( updates[i], Layout::stencil_element( array, i, local_elts, radius ) );
+          }
+        }
+      }
+    } else {
+      for( std::size_t position = begin; position < end; ++position ){
+        prefetch( position, array, updates );
+        const std::size_t i = index( position );
+        if( i < valid_begin || i >= valid_end ) continue;
+        store_element( updates[i], Layout::stencil_element( array, i, local_elts, radius ) );
+        if( accumulate_sum ) sum += widen( updates[i] );
+      }
+    }
+
+    return (double) sum;
+  }
+
+  // \brief Sum a range of positions
+  // \param begin first position
+  // \param end one past the last position
+  // \return sum of the elements
+  double sum( std::size_t begin, std::size_t end ) const {
+    const T* const array = local_array;
+    accumulate_type sum = 0;
+    #pragma omp simd reduction(+: sum)
+    for( std::size_t position = begin; position < end; ++position ){
+      prefetch( position, array, nullptr );
+      sum += widen( array[index( position )] );
+    }
+    return (double) sum;
+  }
+};
+
+} // namespace miniapp
+
+#endif // MINIAPP_DISTRIBUTED_ARRAY_HPP
@@ -0,0 +1,106 @@
+// Explicit instantiations of the templated local distributed array core,
+// exported through the C interface in distributed_array_core.h.
+#include "distributed_array_core.h"
+#include "distributed_array.hpp"
+
+#include <cstdint>
+
+namespace {
+
+using namespace miniapp;
+
+// \brief Build the typed array from a C view
+template< typename Array >
+inline Array make_array( const core_view_t* view ){
+  using T = typename Array::element_type;
+  using Index = typename Array::index_type;
+  Array array;
+  array.local_array       = static_cast< T* >( view->local_array );
+  array.update_array      = static_cast< T* >( view->update_array );
+  array.local_elts        = view->local_elts;
+  array.radius            = view->radius;
+  array.global_offset     = view->global_offset;
+  array.total_elts        = view->total_elts;
+  array.indices           = static_cast< const Index* >( view->indices );
+  array.prefetch_distance = view->prefetch_distance;
+  return array;
+}
+
+template< typename T >
+double load( const void* array, std::size_t i ){
+  using C = typename compute_type< T >::type;
+  return (double)(C) static_cast< const T* >( array )[i];
+}
+
+template< typename T >
+void store( void* array, std::size_t i, double value ){
+  using C = typename compute_type< T >::type;
+  static_cast< T* >( array )[i] = T( (C) value );
+}
+
+template< typename T >
+core_element_ops_t element_ops(){
+  return core_element_ops_t{ sizeof(T), load< T >, store< T > };
+}
+
+template< typename Array >
+void init( const core_view_t* view, std::size_t begin, std::size_t end ){
+  make_array< Array >( view ).init( begin, end );
+}
+
+template< typename Array >
+double stencil( const core_view_t* view, std::size_t begin, std::size_t end, std::size_t valid_begin, std::size_t valid_end, bool accumulate_sum ){
+  return make_array< Array >( view ).stencil( begin, end, valid_begin, valid_end, accumulate_sum );
+}
+
+template< typename Array >
+double sum( const core_view_t* view, std::size_t begin, std::size_t end ){
+  return make_array< Array >( view ).sum( begin, end );
+}
+
+template< typename T, typename IterationOrder, typename Layout >
+core_kernels_t kernels(){
+  using Array = distributed_array< T, IterationOrder, Layout >;
+  return core_kernels_t{ init< Array >, stencil< Array >, sum< Array > };
+}
+
+template< typename T, typename IterationOrder >
+core_kernels_t kernels( core_layout_t layout ){
+  switch( layout ){
+    case core_layout_compact: return kernels< T, IterationOrder, compact_layout >();
+    case core_layout_ghost:   return kernels< T, IterationOrder, ghost_layout >();
+  }
+  return core_kernels_t{ nullptr, nullptr, nullptr };
+}
+
+template< typename T >
+core_kernels_t kernels( core_order_t order, core_layout_t layout ){
+  switch( order ){
+    case core_order_direct:     return kernels< T, direct_order >( layout );
+    case core_order_indirect32: return kernels< T, indirect_order< std::uint32_t > >( layout );
+    case core_order_indirect64: return kernels< T, indirect_order< std::size_t > >( layout );
+  }
+  return core_kernels_t{ nullptr, nullptr, nullptr };
+}
+
+} // namespace
+
+core_element_ops_t get_core_element_ops( element_type_t element_type ){
+  switch( element_type ){
+    case element_float:       return element_ops< float >();
+    case element_double:      return element_ops< double >();
+    case element_long_double: return element_ops< long double >();
+    case element_bfloat16:    return element_ops< bfloat16 >();
+  }
+  return core_element_ops_t{ 0, nullptr, nullptr };
+}
+
+core_kernels_t get_core_kernels( element_type_t element_type, core_order_t order, core_layout_t layout ){
+  switch( element_type ){
+    case element_float:       return kernels< float >( order, layout );
+    case element_double:      return kernels< double >( order, layout );
+    case element_long_double: return kernels< long double >( order, layout );
+    case element_bfloat16:    return kernels< bfloat16 >( order, layout );
+  }
+  return core_kernels_t{ nullptr, nullptr, nullptr };
+}
@@ -0,0 +1,94 @@
+// C interface to the templated local distributed array core (distributed_array.hpp).
+//
+// Every combination of element type, iteration order and layout is explicitly
+// instantiated in distributed_array_core.cpp. The caller picks one with
+// get_core_kernels, once per loop, and then calls its kernels on ranges of
+// positions, so no per-element dispatch is left in the loops.
+//
+// The C kernels of miniapp.c are kept next to the core rather than wrapping
+// it: they are the hand-written baselines (-x scalar, avx2, avx512) the
+// core is compared against, and they also cover what the core does not
+// (stencil operators, grids, temporal tiling, the "feistel" order). Reduced
+// precisions (-p) always go through the core.
+#ifndef MINIAPP_DISTRIBUTED_ARRAY_CORE_H
+#define MINIAPP_DISTRIBUTED_ARRAY_CORE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Element type enum
+typedef enum {
+  element_float,
+  element_double,
+  element_long_double,
+  element_bfloat16, // stored as the upper half of a float, computed in float
+} element_type_t;
+
+// Iteration order enum
+typedef enum {
+  core_order_direct,     // ascending local indices
+  core_order_indirect32, // indirection array of uint32_t
+  core_order_indirect64, // indirection array of size_t
+} core_order_t;
+
+// Layout enum
+typedef enum {
+  core_layout_compact, // no ghost cells, radius 1, truncated at the ends
+  core_layout_ghost,   // radius valid ghost cells on each side
+} core_layout_t;
+
+// View of one rank's local portion of a distributed array
+// Arrays point to local index 0 and hold elements of the element type.
+typedef struct {
+  void* local_array;        // array read
+  void* update_array;       // array stencil updates are written to
+  size_t local_elts;        // number of local elements
+  size_t radius;            // stencil radius (1 for the compact layout)
+  size_t global_offset;     // global index of local index 0
+  size_t total_elts;        // number of elements across all ranks
+  const void* indices;      // indirection array (indirect orders only)
+  size_t prefetch_distance; // positions ahead to prefetch (indirect orders only), 0 for none
+} core_view_t;
+
+// Kernels of one instantiation
+// All work on the positions [begin, end) of the iteration order.
+typedef struct {
+  // Initialize with arbitrary values
+  void (*init)( const core_view_t* view, size_t begin, size_t end );
+  // Stencil the elements with a local index in [valid_begin, valid_end),
+  // return their sum if accumulate_sum, otherwise 0
+  double (*stencil)( const core_view_t* view, size_t begin, size_t end, size_t valid_begin, size_t valid_end, bool accumulate_sum );
+  // Return the sum of the elements
+  double (*sum)( const core_view_t* view, size_t begin, size_t end );
+} core_kernels_t;
+
+// Accessors of single elements of an element type
+// For the few elements the caller reads or writes itself (e.g. halos),
+// converting to and from double.
+typedef struct {
+  size_t size; // bytes per element
+  double (*load)( const void* array, size_t i );
+  void (*store)( void* array, size_t i, double value );
+} core_element_ops_t;
+
+// \brief Get the element accessors of an element type
+// \param element_type element type
+// \return element accessors
+core_element_ops_t get_core_element_ops( element_type_t element_type );
+
+// \brief Get the kernels of an instantiation
+// \param element_type element type
+// \param order iteration order
+// \param layout layout
+// \return kernels
+core_kernels_t get_core_kernels( element_type_t element_type, core_order_t order, core_layout_t layout );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MINIAPP_DISTRIBUTED_ARRAY_CORE_H
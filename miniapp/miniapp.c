@@ -3,6 +3,7 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <limits.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <time.h>
@@ -12,6 +13,24 @@
 #include <mpi.h>
 #include <assert.h>
 
+#include "distributed_array_core.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MINIAPP_X86_SIMD 1
+#else
+#define MINIAPP_X86_SIMD 0
+#endif
+
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define MINIAPP_PERF_EVENTS 1
+#else
+#define MINIAPP_PERF_EVENTS 0
+#endif
+
 #define min(x, y) (((x)<(y))?(x):(y))
 #define max(x, y) (((x)>(y))?(x):(y))
 
@@ -44,65 +63,300 @@ bool isinteger( const char* str ){
   return isunsignedinteger( str + start );
 }
 
+// Number of heap allocations made through counted_malloc on this rank.
+// Used to confirm that the steady-state iteration loop allocates nothing.
+size_t global_allocation_count = 0;
+
+// Phases of the program timed on every rank
+// Reported at the end with their min/avg/max across ranks (see report_phase_seconds).
+typedef enum {
+  phase_program_init, // program_init, including MPI_Init
+  phase_allocate,     // allocate_distributed_array, but the indirection setup
+  phase_indirection,  // creating the indirection arrays (or feistel permutations)
+  phase_init,         // init_distributed_array
+  phase_stencil,      // local stencil, overlapping the halo exchange (and the sum, with -f)
+  phase_halo_wait,    // waiting on the halo exchange
+  phase_end_fixup,    // elements computed once the halos arrived
+  phase_sum,          // sum_local_array (the local passes, with -R)
+  phase_reduce,       // reducing local sums into distributed sums (-r), and completing deferred ones
+  phase_barrier,      // -w barriers
+  phase_count
+} phase_t;
+
+// \brief Get printable name of a phase
+// \param phase phase
+// \return null-terminated name
+const char* phase_name( const phase_t phase ){
+  switch( phase ){
+    case phase_program_init: return "program_init";
+    case phase_allocate:     return "allocate";
+    case phase_indirection:  return "indirection";
+    case phase_init:         return "init";
+    case phase_stencil:      return "stencil";
+    case phase_halo_wait:    return "halo wait";
+    case phase_end_fixup:    return "end fix-up";
+    case phase_sum:          return "sum";
+    case phase_reduce:       return "reduce";
+    case phase_barrier:      return "barrier";
+    default:                 return "unknown";
+  }
+}
+
+// Seconds this rank has spent in each phase.
+double global_phase_seconds[phase_count] = { 0.0 };
+
+// Number of iterations ahead that indirect loops prefetch, 0 for none.
+// Set from -P at program init, and changed by sweep_prefetch_distance.
+size_t global_prefetch_distance = 0;
+
+// \brief Prefetch one element of up to two arrays
+// \param read_array array that will be read at index, or NULL
+// \param write_array array that will be written at index, or NULL
+// \param index element to prefetch
+static inline void prefetch_element( const double* read_array, const double* write_array, const size_t index ){
+  if( read_array  != NULL ) __builtin_prefetch( read_array + index, 0 );
+  if( write_array != NULL ) __builtin_prefetch( write_array + index, 1 );
+}
+
+// \brief malloc that increments global_allocation_count
+// Note: not thread-safe; only call outside of parallel regions.
+// \param size number of bytes to allocate
+// \return pointer to allocated memory
+void* counted_malloc( size_t size ){
+  global_allocation_count += 1;
+  return malloc( size );
+}
+
+// Keyed bijection over [0, n_elts), see feistel_permute
+// Used by -o "feistel" to compute a random iteration order on the fly.
+#define FEISTEL_ROUNDS 4
+typedef struct {
+  size_t n_elts;                      // Size of the permuted range
+  unsigned half_bits;                 // Width of each half, the network permutes [0, 2^(2*half_bits))
+  uint64_t half_mask;                 // (1 << half_bits) - 1
+  uint64_t round_keys[FEISTEL_ROUNDS];
+} feistel_permutation_t;
+
+// \brief Round function of the Feistel network
+// Note: splitmix64 finalizer of the keyed half.
+static inline uint64_t feistel_round( uint64_t half, const uint64_t round_key ){
+  half += round_key;
+  half = ( half ^ ( half >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+  half = ( half ^ ( half >> 27 ) ) * 0x94D049BB133111EBull;
+  return half ^ ( half >> 31 );
+}
+
+// \brief Permute an index with a balanced Feistel network
+// The network is a bijection on [0, 2^(2*half_bits)), which is less than 4
+// times n_elts. Cycle walking (re-applying it until the result is in range)
+// restricts it to a bijection on [0, n_elts), in under 4 applications on average.
+// \param permutation permutation to apply
+// \param index index in [0, n_elts)
+// \return permuted index in [0, n_elts)
+static inline size_t feistel_permute( const feistel_permutation_t* permutation, const size_t index ){
+  uint64_t x = index;
+  do {
+    uint64_t left  = x >> permutation->half_bits;
+    uint64_t right = x & permutation->half_mask;
+    for( int round = 0; round < FEISTEL_ROUNDS; ++round ){
+      const uint64_t next = left ^ ( feistel_round( right, permutation->round_keys[round] ) & permutation->half_mask );
+      left = right;
+      right = next;
+    }
+    x = ( left << permutation->half_bits ) | right;
+  } while( x >= permutation->n_elts );
+  return x;
+}
+
+// Persistent requests of a halo exchange, at most
+// a send and a receive on both faces of 3 dimensions
+#define MAX_HALO_REQUESTS 12
+
+// Indices into distributed_array.grid_faces[dim]
+typedef enum {
+  grid_face_send_low,  // first owned layer, sent to the low neighbor
+  grid_face_send_high, // last owned layer, sent to the high neighbor
+  grid_face_recv_low,  // low ghost layer, received from the low neighbor
+  grid_face_recv_high, // high ghost layer, received from the high neighbor
+  grid_face_count
+} grid_face_index_t;
+
 // Distributed array
 typedef struct {
   double* local_array;           // Pointer to start of local portion of array
+  double* update_array;          // Second buffer of local_elts elements that stencil updates are written into.
+                                 // Swapped with local_array after each stencil, so its contents are unspecified.
+  element_type_t element_type;   // Type of the elements of both buffers
+                                 // Note: unless double, the buffers are only accessed through the templated
+                                 //       core (or load/store_local_element), never indexed as double*.
+  int active_buffer;             // Which of the two buffers (0 or 1) local_array currently is
   size_t total_elts;             // Total number of elements in distributed array
   size_t local_elts;             // Number of elements maintained by this rank in local_array
   size_t global_offset;          // Index in global array that is locally index 0
 
+  // Cartesian grid (only used with -D 2 or 3)
+  // Dimensions are ordered slowest to fastest varying, and a 2D grid only
+  // uses the last two (the first has extent 1, and no ghost cells). Both
+  // buffers hold the local block with one ghost cell on each side of every
+  // used dimension, and local_array points to the first ghost cell.
+  // Halos are exchanged with the face neighbors along every used dimension.
+  int n_dims;                       // 1 for the distributed array
+  size_t grid_local_dims[3];        // elements owned along each dimension (local_elts is their product)
+  size_t grid_padded_dims[3];       // same, with the ghost cells
+  size_t grid_offsets[3];           // global index of local index 0 along each dimension
+  MPI_Comm grid_comm;               // Cartesian communicator, MPI_COMM_NULL for the distributed array
+  int grid_neighbors[3][2];         // low and high face neighbors in grid_comm, MPI_PROC_NULL at the edges
+  MPI_Datatype grid_faces[3][4];    // faces of a buffer along each used dimension, indexed by grid_face_index_t
+
+  // Ghost-cell layout (only used with -g)
+  // Both buffers are padded with ghost_elts cells on each side, so
+  // local_array[-ghost_elts] through local_array[local_elts+ghost_elts-1] are
+  // valid. Neighbor halos are received directly into the ghost cells.
+  size_t ghost_elts;             // Ghost cells on each side of the local portion (0 for compact layout)
+
+  // Temporal blocking (only used with -k)
+  // Halos of depth radius*k are exchanged every k stencils. In between, the
+  // stencil is also applied to the part of the ghost cells that later steps
+  // still need, redundantly recomputing the neighbors' edges.
+  size_t temporal_step;          // Stencils since the last halo exchange, in [0, k)
+  size_t halo_messages_sent;     // Halo messages this rank has sent
+  size_t halo_messages_saved;    // Halo messages a one-step-per-exchange stencil would have sent in addition
+  size_t redundant_updates;      // Ghost cells this rank has (redundantly) computed
+
+  // Temporal tiling (only used with -T)
+  // All k steps of a temporal block are computed by the first stencil of the
+  // block, so the sums of the later steps are kept until they are asked for.
+  double* tiled_level_sums;      // Local sums of the k levels computed by the last tiled sweep
+  size_t tiled_level;            // Level (1 to k) of the last tiled sweep the local array logically is at, 0 before the first stencil
+
   // To mimic/exacerbate caching issues, may use one or more inderection arrays
-  // if necessary (when using -o "indirect" or "random")
+  // if necessary (when using -o "indirect" or "random"), or computed
+  // permutations (when using -o "feistel")
   size_t** indirection_arrays;   // array of indirection arrays
+  uint32_t** compact_indirection_arrays; // same, with 32-bit indices, used instead when local_elts fits
   // Each element in this array, is another array with local_elts number of elements.
   // Each element is an index into local_array.
   // Order is unspecified here.
   // Can be ascending (if using -o "indirect")
   // Can be random (if using -o "random")
+  // Can be partly random or regular (if using the parameterized orders,
+  // see create_local_indirection_array)
   // For -o "random", multiple arrays are created so that a loop sequence
   // is unlikely to benifit from caching the previous values
-  size_t n_indirection_arrays;   // total number of local indirection arrays
-  size_t indirection_array_next; // which indirection array to use next
-
+  // For -o "feistel", the same number of permutations are rotated through,
+  // but no arrays are stored. Each index is permuted when it is used.
+  feistel_permutation_t* feistel_permutations; // array of n_indirection_arrays permutations, or NULL
+  size_t n_indirection_arrays;   // total number of local indirection arrays (or permutations)
+  size_t indirection_array_next; // which indirection array (or permutation) to use next
+
+  // Persistent halo exchange state (only used with -e "persistent")
+  // Requests are created once, and every stencil just starts and completes
+  // them. The compact layout exchanges through the fixed halo_buffers with
+  // the first set of requests. The ghost-cell layout exchanges directly
+  // to/from the array, with one set of requests per buffer (see active_buffer).
+  double* halo_buffers;            // halo_buffer_count elements, indexed by halo_buffer_index_t (compact layout only)
+  MPI_Request halo_requests[2][MAX_HALO_REQUESTS]; // persistent requests, only first n_halo_requests of each set are valid
+  int n_halo_requests;
+
+  // Deferred sum reduction state (only used with -r "iallreduce")
+  // A nonblocking reduction is started by reduce_local_sums, completed during
+  // the next stencil, and its result is picked up by collect_deferred_sum.
+  MPI_Request sum_request;       // in-flight reduction, or MPI_REQUEST_NULL
+  double sum_request_local;      // send buffer of the in-flight reduction
+  double sum_request_global;     // receive buffer of the in-flight reduction
+  double completed_sum;          // result of the last completed reduction
+  bool has_completed_sum;        // whether completed_sum is yet to be collected
 
 } distributed_array;
 
+// \brief Whether a distributed array is iterated over in the default order
+// \param distributed_array distributed array object
+// \return true unless iterating through indirection arrays or permutations
+static inline bool has_default_iteration_order( const distributed_array* distributed_array ){
+  return distributed_array->indirection_arrays == NULL
+      && distributed_array->compact_indirection_arrays == NULL
+      && distributed_array->feistel_permutations == NULL;
+}
+
+// \brief Use the next indirection array (or permutation), if any
+// \param distributed_array distributed array object
+static inline void advance_iteration_order( distributed_array* distributed_array ){
+  if( distributed_array->n_indirection_arrays > 0 ){
+    distributed_array->indirection_array_next =
+    // if this current inridection array is the last array, use the first
+    ( distributed_array->indirection_array_next == distributed_array->n_indirection_arrays - 1 )
+      ? 0
+      // Otherwise use the next array
+      : ( distributed_array->indirection_array_next + 1 );
+  }
+}
+
+// Indices into distributed_array.halo_buffers
+typedef enum {
+  halo_send_low,     // local_array[0], sent to rank - 1
+  halo_send_high,    // local_array[local_elts-1], sent to rank + 1
+  halo_recv_low,     // last element of rank - 1
+  halo_recv_high,    // first element of rank + 1
+  halo_buffer_count
+} halo_buffer_index_t;
+
 // Macro for iterating over distributed array
+// Must be encountered by all threads of an omp parallel region (or outside of
+// any parallel region), see scheduled_for.
+// When iterating through indirection arrays, the elements of prefetch_read
+// and prefetch_write global_prefetch_distance iterations ahead are prefetched.
 // ptr_distributed_array: (distributed_array_t*)
 // iterator: symbol
+// prefetch_read: (const double*) array the body reads at iterator, or NULL
+// prefetch_write: (double*) array the body writes at iterator, or NULL
 // body: statement list
-// Note: the for loop is the first 'line', so that openmp can be used on it.
-#define distributed_array_local_for( ptr_distributed_array, iterator, body )  \
-  for(                                                                        \
-    size_t iterator ## idx = 0;                                               \
-    iterator ## idx < (ptr_distributed_array)->local_elts;                    \
-    ++ iterator ## idx                                                        \
-  ){                                                                          \
-    size_t iterator;                                                          \
+#define distributed_array_local_for( ptr_distributed_array, iterator, prefetch_read, prefetch_write, body ) \
+  {                                                                           \
+    /* Each iteration order gets its own loop, so the choice of order is made \
+       once per loop, rather than once per element */                         \
+    const size_t iterator ## prefetch_distance = global_prefetch_distance;    \
     /* if using indirection arrays, use i'th indirect index iterator */       \
-    if( ptr_distributed_array->indirection_arrays != NULL ){                  \
-      /* note: would love to have this be outside the loop, but need for      \
-         statement exposed for openmp pragma. The expression getting the      \
-         indirection array is likely to be common-subexpression-eliminated */ \
-      iterator = ptr_distributed_array->indirection_arrays[ptr_distributed_array->indirection_array_next][iterator ## idx]; \
+    if( (ptr_distributed_array)->compact_indirection_arrays != NULL ){        \
+      const uint32_t* iterator ## indices = (ptr_distributed_array)->compact_indirection_arrays[(ptr_distributed_array)->indirection_array_next]; \
+      scheduled_for( (ptr_distributed_array)->local_elts, iterator ## idx, {  \
+        const size_t iterator ## ahead = iterator ## idx + iterator ## prefetch_distance; \
+        if( iterator ## prefetch_distance > 0 && iterator ## ahead < (ptr_distributed_array)->local_elts ){ \
+          prefetch_element( (prefetch_read), (prefetch_write), iterator ## indices[iterator ## ahead] ); \
+        }                                                                     \
+        const size_t iterator = iterator ## indices[iterator ## idx];         \
+        /* do loop body */                                                    \
+        { body }                                                              \
+      } );                                                                    \
+    }                                                                         \
+    else if( (ptr_distributed_array)->indirection_arrays != NULL ){           \
+      const size_t* iterator ## indices = (ptr_distributed_array)->indirection_arrays[(ptr_distributed_array)->indirection_array_next]; \
+      scheduled_for( (ptr_distributed_array)->local_elts, iterator ## idx, {  \
+        const size_t iterator ## ahead = iterator ## idx + iterator ## prefetch_distance; \
+        if( iterator ## prefetch_distance > 0 && iterator ## ahead < (ptr_distributed_array)->local_elts ){ \
+          prefetch_element( (prefetch_read), (prefetch_write), iterator ## indices[iterator ## ahead] ); \
+        }                                                                     \
+        const size_t iterator = iterator ## indices[iterator ## idx];         \
+        { body }                                                              \
+      } );                                                                    \
+    }                                                                         \
+    /* if using permutations, permute i */                                    \
+    /* Note: not prefetched, the index ahead would cost a second permutation */ \
+    else if( (ptr_distributed_array)->feistel_permutations != NULL ){         \
+      const feistel_permutation_t* iterator ## permutation = &(ptr_distributed_array)->feistel_permutations[(ptr_distributed_array)->indirection_array_next]; \
+      scheduled_for( (ptr_distributed_array)->local_elts, iterator ## idx, {  \
+        const size_t iterator = feistel_permute( iterator ## permutation, iterator ## idx ); \
+        { body }                                                              \
+      } );                                                                    \
     }                                                                         \
     /* otherwise use literal index */                                         \
     else {                                                                    \
-      iterator = iterator ## idx;                                             \
-    }                                                                         \
-    /* do loop body */                                                        \
-    {                                                                         \
-      body                                                                    \
+      scheduled_for( (ptr_distributed_array)->local_elts, iterator, {         \
+        { body }                                                              \
+      } );                                                                    \
     }                                                                         \
-  }                                                                           \
-  /* set next indirection_array */                                            \
-  if( ptr_distributed_array->indirection_arrays != NULL ){                    \
-    (ptr_distributed_array)->indirection_array_next =                         \
-    /* if this current inridection array is the last array, use the first */  \
-    ((ptr_distributed_array)->indirection_array_next == (ptr_distributed_array)->n_indirection_arrays - 1 ) \
-      ? 0                                                                     \
-      /* Otherwise use the next array */                                      \
-      : ((ptr_distributed_array)->indirection_array_next + 1);                \
+    /* set next indirection_array, once every thread is done with this one */ \
+    _Pragma( "omp single" )                                                   \
+    advance_iteration_order( ptr_distributed_array );                         \
   }
 
 
@@ -117,13 +371,136 @@ typedef enum {
   iteration_order_regular_order             = 0,
   iteration_order_ascending_indirect_order  = (1 << 0) | 1,
   iteration_order_random_order              = (2 << 1) | 1,
+  iteration_order_feistel_order             = (3 << 1),
+  iteration_order_reverse_order             = (4 << 1) | 1,
+  iteration_order_strided_order             = (5 << 1) | 1,
+  iteration_order_block_random_order        = (6 << 1) | 1,
+  iteration_order_block_shuffle_order       = (7 << 1) | 1,
+  iteration_order_page_random_order         = (8 << 1) | 1,
 } iteration_order_type_t;
 
-// iteration_order_type_t will have bit 0 set if using some indirection
+// iteration_order_type_t will have bit 0 set if using some indirection array
+// Note: feistel_order is computed, and uses no indirection array.
 inline bool is_iteration_order_indirect( const iteration_order_type_t iteration_order_type ){
   return ( iteration_order_type & 1 ) != 0;
 }
 
+// Stencil kernel enum
+// Selects the implementation of the local stencil when iterating in the default
+// order. Indirect orders always use the generic distributed_array_local_for loop,
+// except with the templated core, which has a kernel for every order.
+typedef enum {
+  stencil_kernel_auto,    // Resolved at program init to the widest supported kernel
+  stencil_kernel_generic, // distributed_array_local_for loop, boundary tests on every element
+  stencil_kernel_scalar,  // Peeled boundaries, branch-free scalar interior
+  stencil_kernel_avx2,    // Peeled boundaries, AVX2 interior
+  stencil_kernel_avx512,  // Peeled boundaries, AVX-512 interior
+  stencil_kernel_templated, // Templated C++ core (distributed_array.hpp), also used for init and sum
+} stencil_kernel_type_t;
+
+// \brief Get printable name of stencil kernel
+// \param stencil_kernel_type stencil kernel
+// \return null-terminated name, as accepted by -x
+const char* stencil_kernel_name( const stencil_kernel_type_t stencil_kernel_type ){
+  switch( stencil_kernel_type ){
+    case stencil_kernel_auto:    return "auto";
+    case stencil_kernel_generic: return "generic";
+    case stencil_kernel_scalar:  return "scalar";
+    case stencil_kernel_avx2:    return "avx2";
+    case stencil_kernel_avx512:  return "avx512";
+    case stencil_kernel_templated: return "templated";
+  }
+  return "unknown";
+}
+
+// Stencil operator enum
+// The update computed from the window A[i-r..i+r] (r is 1 unless -g is given).
+// Indexes the stencil_operators registry.
+typedef enum {
+  stencil_operator_maxmin,         // max( window ) / (1 + abs( min( window ) ) )
+  stencil_operator_jacobi,         // mean( window )
+  stencil_operator_weighted,       // binomial weights over the window
+  stencil_operator_transcendental, // mean( sin( window ) * exp( -abs( window ) ) )
+  stencil_operator_count
+} stencil_operator_type_t;
+
+// Registry entry of a stencil operator
+typedef struct {
+  const char* name;        // as accepted by -K
+  const char* description; // printed with the flops per update
+} stencil_operator_t;
+
+// Registry of stencil operators, indexed by stencil_operator_type_t
+const stencil_operator_t stencil_operators[stencil_operator_count] = {
+  [stencil_operator_maxmin]         = { "maxmin",         "max( A[i-r..i+r] ) / (1 + abs( min( A[i-r..i+r] ) ) )" },
+  [stencil_operator_jacobi]         = { "jacobi",         "mean( A[i-r..i+r] )" },
+  [stencil_operator_weighted]       = { "weighted",       "sum( binomial(2r, j+r) / 4^r * A[i+j] ), j in [-r, r]" },
+  [stencil_operator_transcendental] = { "transcendental", "mean( sin( A[i-r..i+r] ) * exp( -abs( A[i-r..i+r] ) ) )" },
+};
+
+// \brief Look up a stencil operator by name
+// \param name name of the operator, as listed in stencil_operators
+// \param stencil_operator_type set to the operator, if found
+// \return true if found, false otherwise
+bool find_stencil_operator( const char* name, stencil_operator_type_t* stencil_operator_type ){
+  for( int i = 0; i < stencil_operator_count; ++i ){
+    if( strcmp( stencil_operators[i].name, name ) == 0 ){
+      *stencil_operator_type = (stencil_operator_type_t) i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// \brief Get printable name of element type
+// \param element_type element type
+// \return null-terminated name, as accepted by -p
+const char* element_type_name( const element_type_t element_type ){
+  switch( element_type ){
+    case element_float:       return "float";
+    case element_double:      return "double";
+    case element_long_double: return "long-double";
+    case element_bfloat16:    return "bf16";
+  }
+  return "unknown";
+}
+
+// Halo exchange enum
+typedef enum {
+  halo_exchange_isend,      // MPI_Isend/MPI_Irecv set up every stencil
+  halo_exchange_persistent, // Persistent requests, MPI_Startall/MPI_Waitall every stencil
+} halo_exchange_type_t;
+
+// Sum reduction strategy enum
+typedef enum {
+  reduction_gather,     // MPI_Gather local sums to primary, primary sums them
+  reduction_reduce,     // MPI_Reduce to primary
+  reduction_allreduce,  // MPI_Allreduce, every rank gets the sum
+  reduction_iallreduce, // MPI_Iallreduce, completed during the next iteration's stencil
+} reduction_type_t;
+
+// \brief Get printable name of reduction strategy
+// \param reduction_type reduction strategy
+// \return null-terminated name, as accepted by -r
+const char* reduction_name( const reduction_type_t reduction_type ){
+  switch( reduction_type ){
+    case reduction_gather:     return "gather";
+    case reduction_reduce:     return "reduce";
+    case reduction_allreduce:  return "allreduce";
+    case reduction_iallreduce: return "iallreduce";
+  }
+  return "unknown";
+}
+
+// Loop schedule enum
+// OpenMP schedules are set with omp_set_schedule, the miniapp schedules are
+// implemented by scheduled_for.
+typedef enum {
+  loop_schedule_openmp,       // OpenMP runtime schedule (-l default/static/dynamic/guided/auto)
+  loop_schedule_static_steal, // Equal contiguous shares, idle threads steal half of another's remaining share
+  loop_schedule_weighted,     // Contiguous shares proportional to each thread's measured throughput
+} loop_schedule_type_t;
+
 // Verbosity enum
 typedef enum {
   verbosity_errors = 0,
@@ -140,6 +517,8 @@ typedef struct {
   const bool initialized;
 
   const int N;
+  const int n_dims;               // 1 for the distributed array, 2 or 3 for a Cartesian grid
+  const size_t grid_dims[3];      // global extents of the grid, slowest varying first (a 2D grid has grid_dims[0] = 1)
   const int iterations;
   const bool synchronize_at_end_of_distributed_array_operations;
   const verbosity_t verbosity;
@@ -148,8 +527,26 @@ typedef struct {
   const int rank, n_ranks, primary_rank, omp_num_threads;
   const MPI_Comm comm;
   const iteration_order_type_t iteration_order_type;
+  const size_t iteration_order_block_elts;
   const omp_sched_t omp_loop_schedule;
   const int omp_chunk_size;
+  const loop_schedule_type_t loop_schedule_type;
+  const stencil_kernel_type_t stencil_kernel_type;
+  const stencil_operator_type_t stencil_operator_type;
+  const int stencil_intensity;    // extra multiply-adds per update (-I)
+  const element_type_t element_type;
+  const bool fuse_stencil_and_sum;
+  const reduction_type_t reduction_type;
+  const bool reproducible_sum;
+  const halo_exchange_type_t halo_exchange_type;
+  const bool ghost_layout;
+  const int stencil_radius;
+  const int temporal_block_depth;
+  const size_t temporal_tile_elts;
+  const size_t prefetch_distance;
+  const bool prefetch_sweep;
+  const size_t probe_elts;
+  const bool hw_counters;
 
   const int seed;
 } program_context_t;
@@ -159,9 +556,544 @@ program_context_t global_program_context = {
   .initialized = false
 };
 
+// Per-thread state of the miniapp loop schedules
+// Note: aligned to a cache line, as every thread updates its own entry
+//       during every loop, and thieves lock other threads' entries.
+#define CACHE_LINE_BYTES 64
+typedef struct __attribute__((aligned(CACHE_LINE_BYTES))) {
+  omp_lock_t lock;          // Protects begin and end from thieves (static-steal)
+  size_t begin, end;        // Iterations this thread has yet to hand out
+  size_t chunk_size;        // Iterations handed out at a time (static-steal)
+  size_t iterations_done;   // Iterations done by this thread during this loop
+  double start_time;        // omp_get_wtime once this loop's shares are published
+  double throughput;        // Iterations per second of this thread during this loop, 0 if not measured (weighted)
+  double weight;            // Relative measured throughput of this thread (weighted)
+} loop_schedule_thread_state;
+
+// One entry per OpenMP thread, allocated by init_loop_schedule
+// Note: miniapp schedules only support one loop at a time, loops are never nested.
+loop_schedule_thread_state* global_loop_schedule_threads = NULL;
+
+// Per-thread work counters, accumulated by every scheduled_for loop
+// Reported per rank at the end, to tune the loop schedule (-l, -c).
+// Note: aligned to a cache line, as every thread updates its own entry at the
+//       end of every loop.
+typedef struct __attribute__((aligned(CACHE_LINE_BYTES))) {
+  size_t elts;          // Elements processed by this thread
+  double busy_seconds;  // Seconds from the start of each loop to this thread's last iteration
+  double wait_seconds;  // Seconds waiting at the barriers around each loop
+} thread_work_counters_t;
+
+// One entry per OpenMP thread, allocated by init_loop_schedule
+thread_work_counters_t* global_thread_work_counters = NULL;
+
+// \brief Zero the work counters of every thread
+void reset_thread_work_counters( ){
+  for( int thread = 0; thread < global_program_context.omp_num_threads; ++thread ){
+    thread_work_counters_t* counters = &global_thread_work_counters[thread];
+    counters->elts = 0;
+    counters->busy_seconds = 0.0;
+    counters->wait_seconds = 0.0;
+  }
+}
+
+// \brief Count elements processed by the calling thread
+// For loops whose iterations do not have a known number of elements, which
+// count them in their body instead (see scheduled_elts_for).
+// \param n_elts number of elements
+static inline void count_thread_elts( const size_t n_elts ){
+  global_thread_work_counters[omp_get_thread_num()].elts += n_elts;
+}
+
+// \brief Allocate and initialize the state of the miniapp loop schedules
+// Note: requires global_program_context to be initialized.
+void init_loop_schedule( ){
+  const int n_threads = global_program_context.omp_num_threads;
+  global_loop_schedule_threads = (loop_schedule_thread_state*) aligned_alloc( CACHE_LINE_BYTES, n_threads * sizeof(loop_schedule_thread_state) );
+  for( int thread = 0; thread < n_threads; ++thread ){
+    loop_schedule_thread_state* state = &global_loop_schedule_threads[thread];
+    omp_init_lock( &state->lock );
+    state->begin = 0;
+    state->end = 0;
+    state->chunk_size = 1;
+    state->iterations_done = 0;
+    state->start_time = 0.0;
+    state->throughput = 0.0;
+    state->weight = 1.0;
+  }
+
+  global_thread_work_counters = (thread_work_counters_t*) aligned_alloc( CACHE_LINE_BYTES, n_threads * sizeof(thread_work_counters_t) );
+  reset_thread_work_counters( );
+}
+
+// \brief Free the state of the miniapp loop schedules
+void free_loop_schedule( ){
+  if( global_loop_schedule_threads == NULL ) return;
+  for( int thread = 0; thread < global_program_context.omp_num_threads; ++thread ){
+    omp_destroy_lock( &global_loop_schedule_threads[thread].lock );
+  }
+  free( global_loop_schedule_threads );
+  global_loop_schedule_threads = NULL;
+  free( global_thread_work_counters );
+  global_thread_work_counters = NULL;
+}
+
+// \brief Start a miniapp-scheduled loop over [0, n_iterations)
+// Each thread is given its initial share of the iterations: an equal share
+// for static-steal, a share proportional to its weight for weighted.
+// Note: must be called by all threads of the parallel region.
+// \param n_iterations number of iterations of the loop
+void start_scheduled_loop( const size_t n_iterations ){
+  const int thread = omp_get_thread_num();
+  const int n_threads = omp_get_num_threads();
+  loop_schedule_thread_state* state = &global_loop_schedule_threads[thread];
+
+  size_t begin, end;
+  if( global_program_context.loop_schedule_type == loop_schedule_weighted ){
+    double total_weight = 0.0, preceding_weight = 0.0;
+    for( int other = 0; other < n_threads; ++other ){
+      if( other == thread ) preceding_weight = total_weight;
+      total_weight += global_loop_schedule_threads[other].weight;
+    }
+    begin = (size_t)( n_iterations * ( preceding_weight / total_weight ) );
+    end   = ( thread == n_threads - 1 ) ? n_iterations : (size_t)( n_iterations * ( ( preceding_weight + state->weight ) / total_weight ) );
+  } else {
+    begin = ( n_iterations * thread ) / n_threads;
+    end   = ( n_iterations * ( thread + 1 ) ) / n_threads;
+  }
+
+  omp_set_lock( &state->lock );
+  state->begin = begin;
+  state->end = end;
+  omp_unset_lock( &state->lock );
+
+  // Default chunk is a sixteenth of the initial share
+  state->chunk_size = ( global_program_context.omp_chunk_size > 0 ) ? global_program_context.omp_chunk_size : max2( ( end - begin ) / 16, 1 );
+  state->iterations_done = 0;
+
+  // All shares are published before any thread can steal
+  #pragma omp barrier
+
+  // Note: after the barrier, so threads reaching the loop early do not look slower
+  state->start_time = omp_get_wtime();
+}
+
+// \brief Get the next chunk of a miniapp-scheduled loop for the calling thread
+// Static-steal hands out chunks from the front of the thread's own share, and
+// once that is empty, steals the back half of another thread's share.
+// Weighted hands out the thread's whole share at once.
+// \param chunk_begin set to the first iteration of the chunk
+// \param chunk_end set to one past the last iteration of the chunk
+// \return whether there was a chunk, false once the loop is done for this thread
+bool next_scheduled_chunk( size_t* chunk_begin, size_t* chunk_end ){
+  const int thread = omp_get_thread_num();
+  const int n_threads = omp_get_num_threads();
+  loop_schedule_thread_state* state = &global_loop_schedule_threads[thread];
+
+  if( global_program_context.loop_schedule_type == loop_schedule_weighted ){
+    if( state->begin >= state->end ) return false;
+    *chunk_begin = state->begin;
+    *chunk_end = state->end;
+    state->begin = state->end;
+    state->iterations_done += *chunk_end - *chunk_begin;
+    return true;
+  }
+
+  // Own share
+  omp_set_lock( &state->lock );
+  if( state->begin < state->end ){
+    *chunk_begin = state->begin;
+    *chunk_end = min2( state->begin + state->chunk_size, state->end );
+    state->begin = *chunk_end;
+    omp_unset_lock( &state->lock );
+    state->iterations_done += *chunk_end - *chunk_begin;
+    return true;
+  }
+  omp_unset_lock( &state->lock );
+
+  // Steal from the other threads, nearest first
+  for( int offset = 1; offset < n_threads; ++offset ){
+    loop_schedule_thread_state* victim = &global_loop_schedule_threads[(thread + offset) % n_threads];
+
+    omp_set_lock( &victim->lock );
+    const size_t remaining = ( victim->begin < victim->end ) ? victim->end - victim->begin : 0;
+    const size_t stolen = ( remaining + 1 ) / 2;
+    victim->end -= stolen;
+    const size_t stolen_begin = victim->end;
+    omp_unset_lock( &victim->lock );
+
+    if( stolen > 0 ){
+      // The stolen iterations become this thread's share, so they can be stolen in turn
+      const size_t stolen_end = stolen_begin + stolen;
+      *chunk_begin = stolen_begin;
+      *chunk_end = min2( *chunk_begin + state->chunk_size, stolen_end );
+
+      omp_set_lock( &state->lock );
+      state->begin = *chunk_end;
+      state->end = stolen_end;
+      omp_unset_lock( &state->lock );
+
+      state->iterations_done += *chunk_end - *chunk_begin;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// \brief Finish a scheduled loop, of any schedule
+// Adds the loop to the calling thread's work counters. For weighted, also
+// updates each thread's weight with its measured throughput, smoothed with its
+// previous weight.
+// Note: must be called by all threads of the parallel region. Acts as a barrier.
+// \param loop_start_time omp_get_wtime when the thread reached the loop
+// \param n_elts elements processed by the thread during the loop
+void finish_scheduled_loop( const double loop_start_time, const size_t n_elts ){
+  const int thread = omp_get_thread_num();
+  loop_schedule_thread_state* state = &global_loop_schedule_threads[thread];
+  thread_work_counters_t* counters = &global_thread_work_counters[thread];
+  const double busy_end_time = omp_get_wtime();
+
+  counters->elts += n_elts;
+  if( global_program_context.loop_schedule_type == loop_schedule_openmp ){
+    counters->busy_seconds += busy_end_time - loop_start_time;
+  } else {
+    // Iterations start at start_time, after the barrier of start_scheduled_loop,
+    // so the wait at that barrier is counted as waiting, not as busy
+    counters->wait_seconds += state->start_time - loop_start_time;
+    counters->busy_seconds += busy_end_time - state->start_time;
+  }
+
+  if( global_program_context.loop_schedule_type != loop_schedule_weighted ){
+    #pragma omp barrier
+    counters->wait_seconds += omp_get_wtime() - busy_end_time;
+    return;
+  }
+
+  const double elapsed = busy_end_time - state->start_time;
+
+  state->throughput = ( elapsed > 0.0 && state->iterations_done > 0 ) ? state->iterations_done / elapsed : 0.0;
+
+  #pragma omp barrier
+  #pragma omp single
+  {
+    const int n_threads = omp_get_num_threads();
+    double total_throughput = 0.0;
+    int n_measured = 0;
+    for( int thread = 0; thread < n_threads; ++thread ){
+      if( global_loop_schedule_threads[thread].throughput > 0.0 ){
+        total_throughput += global_loop_schedule_threads[thread].throughput;
+        n_measured += 1;
+      }
+    }
+    // Threads without a measurement (no iterations, too fast to time) keep their weight
+    if( n_measured > 0 ){
+      const double mean_throughput = total_throughput / n_measured;
+      for( int thread = 0; thread < n_threads; ++thread ){
+        loop_schedule_thread_state* other = &global_loop_schedule_threads[thread];
+        if( other->throughput > 0.0 ){
+          other->weight = 0.5 * other->weight + 0.5 * ( other->throughput / mean_throughput );
+        }
+      }
+    }
+  }
+  counters->wait_seconds += omp_get_wtime() - busy_end_time;
+}
+
+// Macro for a loop over [0, n_iterations) with the program's loop schedule (-l, -c)
+// Must be encountered by all threads of an omp parallel region (or outside of
+// any parallel region). OpenMP schedules are applied through schedule(runtime),
+// miniapp schedules through start_scheduled_loop/next_scheduled_chunk. Either
+// way, the loop ends with finish_scheduled_loop, which times the wait at its
+// barrier separately from the iterations (see thread_work_counters_t).
+// n_iterations: (size_t), same on all threads
+// iterator: symbol
+// iteration_elts: (size_t) elements processed by iteration iterator, 0 if the body counts them itself (see count_thread_elts)
+// body: statement list
+#define scheduled_elts_for( n_iterations, iterator, iteration_elts, body )      \
+  {                                                                              \
+    const double iterator ## loop_start_time = omp_get_wtime();                  \
+    size_t iterator ## loop_elts = 0;                                            \
+    if( global_program_context.loop_schedule_type == loop_schedule_openmp ){     \
+      _Pragma( "omp for schedule(runtime) nowait" )                              \
+      for( size_t iterator = 0; iterator < (n_iterations); ++iterator ){         \
+        iterator ## loop_elts += (iteration_elts);                               \
+        body                                                                     \
+      }                                                                          \
+    } else {                                                                     \
+      size_t iterator ## chunk_begin, iterator ## chunk_end;                     \
+      start_scheduled_loop( (n_iterations) );                                    \
+      while( next_scheduled_chunk( &iterator ## chunk_begin, &iterator ## chunk_end ) ){ \
+        for( size_t iterator = iterator ## chunk_begin; iterator < iterator ## chunk_end; ++iterator ){ \
+          iterator ## loop_elts += (iteration_elts);                             \
+          body                                                                   \
+        }                                                                        \
+      }                                                                          \
+    }                                                                            \
+    finish_scheduled_loop( iterator ## loop_start_time, iterator ## loop_elts ); \
+  }
+
+// Macro for a scheduled loop whose iterations each process one element
+// See scheduled_elts_for.
+#define scheduled_for( n_iterations, iterator, body )                            \
+  scheduled_elts_for( n_iterations, iterator, 1, body )
+
+
+// Hardware events counted per thread with -H
+typedef enum {
+  hw_counter_cycles,
+  hw_counter_instructions,
+  hw_counter_cache_misses,
+  hw_counter_dtlb_misses,
+  hw_counter_count
+} hw_counter_t;
+
+// \brief Get printable name of a hardware event
+// \param counter hardware event
+// \return null-terminated name
+const char* hw_counter_name( const hw_counter_t counter ){
+  switch( counter ){
+    case hw_counter_cycles:       return "cycles";
+    case hw_counter_instructions: return "instructions";
+    case hw_counter_cache_misses: return "cache misses";
+    case hw_counter_dtlb_misses:  return "dTLB misses";
+    default:                      return "unknown";
+  }
+}
+
+// Per-thread perf_event_open counters (only used with -H)
+// Note: aligned to a cache line, like loop_schedule_thread_state, although
+//       the counters are only read and written by the master thread.
+typedef struct __attribute__((aligned(CACHE_LINE_BYTES))) {
+  int fds[hw_counter_count]; // One counter per event, -1 for events that could not be opened
+} hw_counter_thread_t;
+
+// One entry per OpenMP thread, allocated by init_hw_counters
+hw_counter_thread_t* global_hw_counter_threads = NULL;
+
+// Whether every thread of this rank counts an event
+bool global_hw_counter_available[hw_counter_count] = { false };
+
+// Events counted in every phase by all threads of this rank, and the counts
+// at the start of the phase in flight (see start_phase)
+double global_phase_hw_counts[phase_count][hw_counter_count] = { { 0.0 } };
+double global_phase_hw_start_counts[phase_count][hw_counter_count] = { { 0.0 } };
+
+// \brief Open a counter of a hardware event for the calling thread
+// User space only, which perf_event_paranoid allows without privileges up to 2.
+// \param counter hardware event
+// \return file descriptor of the counter, -1 (with errno set) if it could not be opened
+int open_hw_counter( const hw_counter_t counter ){
+#if MINIAPP_PERF_EVENTS
+  struct perf_event_attr attr;
+  memset( &attr, 0, sizeof(attr) );
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  switch( counter ){
+    case hw_counter_cycles:       attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case hw_counter_instructions: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case hw_counter_cache_misses: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+    case hw_counter_dtlb_misses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+      break;
+    default: break;
+  }
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // Note: counters are multiplexed when there are more than the PMU has, see read_hw_counters
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int) syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+// \brief Read the value of kernel.perf_event_paranoid
+// \return its value, INT_MIN if it cannot be read
+int read_perf_event_paranoid( ){
+  int paranoid = INT_MIN;
+  FILE* file = fopen( "/proc/sys/kernel/perf_event_paranoid", "r" );
+  if( file != NULL ){
+    if( fscanf( file, "%d", &paranoid ) != 1 ) paranoid = INT_MIN;
+    fclose( file );
+  }
+  return paranoid;
+}
+
+// \brief Open the hardware counters of every OpenMP thread (-H)
+// Each thread opens its own counters, so they follow it across CPUs. Events
+// some thread cannot count are closed on all threads, and reported with the
+// reason and perf_event_paranoid, but the run goes on without them.
+// Note: relies on the OpenMP runtime reusing the same threads for every
+//       parallel region of omp_num_threads threads, as the usual runtimes do.
+//       Requires global_program_context to be initialized.
+void init_hw_counters( ){
+  const int n_threads = global_program_context.omp_num_threads;
+  global_hw_counter_threads = (hw_counter_thread_t*) aligned_alloc( CACHE_LINE_BYTES, n_threads * sizeof(hw_counter_thread_t) );
+  int open_errors[hw_counter_count] = { 0 };
+
+  #pragma omp parallel
+  {
+    hw_counter_thread_t* thread = &global_hw_counter_threads[omp_get_thread_num()];
+    for( int counter = 0; counter < hw_counter_count; ++counter ){
+      thread->fds[counter] = open_hw_counter( counter );
+      if( thread->fds[counter] < 0 ){
+        #pragma omp atomic write
+        open_errors[counter] = errno;
+      }
+    }
+  }
+
+  for( int counter = 0; counter < hw_counter_count; ++counter ){
+    global_hw_counter_available[counter] = ( open_errors[counter] == 0 );
+    if( global_hw_counter_available[counter] ) continue;
+
+    for( int thread = 0; thread < n_threads; ++thread ){
+      if( global_hw_counter_threads[thread].fds[counter] >= 0 ) close( global_hw_counter_threads[thread].fds[counter] );
+      global_hw_counter_threads[thread].fds[counter] = -1;
+    }
+    if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
+      printf( "Hardware counter \"%s\" unavailable: %s (perf_event_paranoid %d)\n", hw_counter_name( counter ), strerror( open_errors[counter] ), read_perf_event_paranoid( ) );
+    }
+  }
+}
+
+// \brief Close the hardware counters, if any
+void free_hw_counters( ){
+  if( global_hw_counter_threads == NULL ) return;
+  for( int thread = 0; thread < global_program_context.omp_num_threads; ++thread ){
+    for( int counter = 0; counter < hw_counter_count; ++counter ){
+      if( global_hw_counter_threads[thread].fds[counter] >= 0 ) close( global_hw_counter_threads[thread].fds[counter] );
+    }
+  }
+  free( global_hw_counter_threads );
+  global_hw_counter_threads = NULL;
+}
+
+// \brief Read the counts of every event, summed over all threads of this rank
+// Counts of multiplexed counters are scaled up to the time they were enabled.
+// Note: a thread can read the counters of the other threads.
+// \param counts set to the count of every event, 0 for unavailable ones
+void read_hw_counters( double counts[hw_counter_count] ){
+  for( int counter = 0; counter < hw_counter_count; ++counter ){
+    counts[counter] = 0.0;
+    if( ! global_hw_counter_available[counter] ) continue;
+    for( int thread = 0; thread < global_program_context.omp_num_threads; ++thread ){
+      uint64_t values[3]; // value, time enabled, time running
+      if( read( global_hw_counter_threads[thread].fds[counter], values, sizeof(values) ) != sizeof(values) || values[2] == 0 ) continue;
+      counts[counter] += (double) values[0] * ( (double) values[1] / values[2] );
+    }
+  }
+}
+
+// \brief Start timing a phase
+// With -H, also takes the counts of the hardware events at the start.
+// \param phase phase
+// \return start time, to pass to end_phase
+double start_phase( const phase_t phase ){
+  if( global_hw_counter_threads != NULL ) read_hw_counters( global_phase_hw_start_counts[phase] );
+  return MPI_Wtime();
+}
+
+// \brief Finish timing a phase, into global_phase_seconds
+// With -H, also adds the hardware events counted since start_phase to
+// global_phase_hw_counts.
+// \param phase phase
+// \param start_time value returned by start_phase
+void end_phase( const phase_t phase, const double start_time ){
+  global_phase_seconds[phase] += MPI_Wtime() - start_time;
+  if( global_hw_counter_threads != NULL ){
+    double counts[hw_counter_count];
+    read_hw_counters( counts );
+    for( int counter = 0; counter < hw_counter_count; ++counter ){
+      global_phase_hw_counts[phase][counter] += counts[counter] - global_phase_hw_start_counts[phase][counter];
+    }
+  }
+}
+
+
+// Partial sums of a reproducible sum (only used with -R)
+// See reproducible_sum_distributed_array.
+typedef struct {
+  __int128 high; // sum of the scaled elements' integer parts
+  __int128 low;  // sum of their remainders, in units of 2^-REPRODUCIBLE_SUM_FOLD_BITS
+} reproducible_sum_t;
+
+// Bits of a scaled element kept by each of the two parts
+// Note: small enough for the parts of LOCAL_KERNEL_BLOCK_ELTS elements to be
+//       summed exactly in double (4096 * 2^40 < 2^53).
+#define REPRODUCIBLE_SUM_FOLD_BITS 40
+
+// MPI datatype and reduction operation of reproducible_sum_t
+MPI_Datatype global_reproducible_sum_type = MPI_DATATYPE_NULL;
+MPI_Op global_reproducible_sum_op = MPI_OP_NULL;
+
+// \brief MPI reduction operation adding partial reproducible sums
+// Note: integer addition is associative, so every reduction tree gives the same result.
+void add_reproducible_sums( void* in, void* inout, int* len, MPI_Datatype* datatype ){
+  // Note: only used with global_reproducible_sum_type, its own contiguous byte type
+  (void) datatype;
+  const reproducible_sum_t* in_sums = (const reproducible_sum_t*) in;
+  reproducible_sum_t* inout_sums = (reproducible_sum_t*) inout;
+  for( int i = 0; i < *len; ++i ){
+    inout_sums[i].high += in_sums[i].high;
+    inout_sums[i].low  += in_sums[i].low;
+  }
+}
+
+// \brief Create the MPI datatype and operation of the reproducible sum
+void init_reproducible_sum( ){
+  MPI_Type_contiguous( sizeof(reproducible_sum_t), MPI_BYTE, &global_reproducible_sum_type );
+  MPI_Type_commit( &global_reproducible_sum_type );
+  MPI_Op_create( add_reproducible_sums, 1, &global_reproducible_sum_op );
+}
+
+// \brief Free the MPI datatype and operation of the reproducible sum, if created
+void free_reproducible_sum( ){
+  if( global_reproducible_sum_op == MPI_OP_NULL ) return;
+  MPI_Op_free( &global_reproducible_sum_op );
+  MPI_Type_free( &global_reproducible_sum_type );
+}
+
+// Weights of the "weighted" stencil operator over the window A[i-r..i+r]
+// (only used with -K weighted)
+double* global_stencil_operator_weights = NULL;
+
+// Coefficients of the intensity dial's multiply-adds (-I)
+// Note: an identity (u * 1 + 0), but read at run time, so it is not folded away.
+double global_stencil_intensity_scale = 1.0;
+double global_stencil_intensity_shift = 0.0;
+
+// \brief Compute the weights of the stencil operator, if it has any
+void init_stencil_operator( ){
+  if( global_program_context.stencil_operator_type != stencil_operator_weighted ) return;
+
+  // Binomial coefficients of 2r, normalized to sum to 1
+  const size_t radius = global_program_context.stencil_radius;
+  global_stencil_operator_weights = (double*) counted_malloc( ( 2 * radius + 1 ) * sizeof(double) );
+  global_stencil_operator_weights[0] = 1.0;
+  for( size_t j = 1; j <= 2 * radius; ++j ){
+    global_stencil_operator_weights[j] = global_stencil_operator_weights[j-1] * ( 2 * radius - j + 1 ) / j;
+  }
+  for( size_t j = 0; j <= 2 * radius; ++j ){
+    global_stencil_operator_weights[j] = ldexp( global_stencil_operator_weights[j], -2 * (int) radius );
+  }
+}
+
+// \brief Free the weights of the stencil operator, if any
+void free_stencil_operator( ){
+  free( global_stencil_operator_weights );
+  global_stencil_operator_weights = NULL;
+}
 
 // Finalize application
 void program_finalize( ){
+  free_stencil_operator( );
+  free_reproducible_sum( );
+  free_hw_counters( );
+  free_loop_schedule( );
   MPI_Finalize();
 }
 
@@ -198,6 +1130,14 @@ program_context_t program_init( int argc, char** argv ){
     }
   }
 
+  // Without OMP_SCHEDULE, keep the static schedule that loops without a
+  // schedule clause get, rather than the runtime's default run-sched-var
+  // (dynamic with chunk 1 in libgomp), now that loops use schedule(runtime).
+  if( getenv( "OMP_SCHEDULE" ) == NULL ){
+    initial_system_omp_schedule = omp_sched_static;
+    initial_system_omp_schedule_modifier = 0;
+  }
+
   // Default argument values
   const int default_N = 10;
   const int default_iterations = 1000;
@@ -207,18 +1147,51 @@ program_context_t program_init( int argc, char** argv ){
   const omp_sched_t default_omp_schedule = initial_system_omp_schedule;
   const int default_omp_chunk_size = initial_system_omp_schedule_modifier;
   const bool default_wait_on_non_collective_distiributed_array_operations = false;
+  const stencil_kernel_type_t default_stencil_kernel = stencil_kernel_auto;
+  const stencil_operator_type_t default_stencil_operator = stencil_operator_maxmin;
+  const int default_stencil_intensity = 0;
+  const element_type_t default_element_type = element_double;
+  const bool default_fuse_stencil_and_sum = false;
+  const reduction_type_t default_reduction_type = reduction_gather;
+  const bool default_reproducible_sum = false;
+  const halo_exchange_type_t default_halo_exchange_type = halo_exchange_isend;
+  const bool default_ghost_layout = false;
+  const int default_stencil_radius = 1;
+  const int default_temporal_block_depth = 1;
+  const size_t default_temporal_tile_elts = 0;
 
 
   // Arguments set with default values, possibly overwritten by flags
   int N = default_N;
+  int n_dims = 1;
+  size_t grid_dims[3] = { 1, 1, 1 };
+  bool explicit_grid_dims = false;
   int iterations = default_iterations;
   verbosity_t verbosity = default_verbosity;
   distribution_type_t distribution_type = distribute_fair;
   iteration_order_type_t iteration_order_type = default_iteration_order;
+  size_t iteration_order_block_elts = 0;
   int omp_num_threads = default_omp_num_threads;
   omp_sched_t omp_schedule = default_omp_schedule;
   int omp_chunk_size = default_omp_chunk_size;
+  loop_schedule_type_t loop_schedule_type = loop_schedule_openmp;
   bool synchronize_at_end_of_distributed_array_operations = default_wait_on_non_collective_distiributed_array_operations;
+  stencil_kernel_type_t stencil_kernel_type = default_stencil_kernel;
+  stencil_operator_type_t stencil_operator_type = default_stencil_operator;
+  int stencil_intensity = default_stencil_intensity;
+  element_type_t element_type = default_element_type;
+  bool fuse_stencil_and_sum = default_fuse_stencil_and_sum;
+  reduction_type_t reduction_type = default_reduction_type;
+  bool reproducible_sum = default_reproducible_sum;
+  halo_exchange_type_t halo_exchange_type = default_halo_exchange_type;
+  bool ghost_layout = default_ghost_layout;
+  int stencil_radius = default_stencil_radius;
+  int temporal_block_depth = default_temporal_block_depth;
+  size_t temporal_tile_elts = default_temporal_tile_elts;
+  size_t prefetch_distance = 0;
+  size_t probe_elts = 0;
+  bool hw_counters = false;
+  bool prefetch_sweep = false;
 
   char* usage_fmt_string = \
     "    -h\n"
@@ -232,27 +1205,43 @@ program_context_t program_init( int argc, char** argv ){
     "    -n <unsigned int>\n"
     "        Equivalent to -N <unsigned int>\n\n"
     "    -d <distribution type>\n"
-    "        Set type of distribution for elements of distributed array.\n"
+    "        Set type of distribution for elements of distributed array (along\n"
+    "        every dimension of a grid).\n"
     "        Values:\n"
     "          \"fair\" : Distribute values fairly.\n"
     "          \"unfair\" : Distribute values unfairly.\n\n"
+    "    -D <dimensions>\n"
+    "        Use a 2D or 3D grid, decomposed over a Cartesian process grid, with\n"
+    "        face halos and a 5-point (2D) or 7-point (3D) stencil.\n"
+    "        Values:\n"
+    "          \"1\"           : The distributed array.\n"
+    "          \"2\", \"3\"      : Square (cubic) grid of at most N elements.\n"
+    "          \"AxB\", \"AxBxC\" : Grid with the given extents (overrides -N).\n"
+    "        Grids require the default loop order and layout, in double.\n"
+    "        Default: \"1\"\n\n"
     "    -w \n"
     "        Force ranks to synchronize at each distributed array opperation.\n\n"
     "    -t <unsigned int>\n"
     "        Set number of OpenMP threads.\n"
     "        Default: %d (system default)\n\n"
     "    -l <OpenMP schedule name>\n"
-    "        Set OpenMP loop schedule.\n"
+    "        Set loop schedule, used by all OpenMP loops.\n"
     "        Values:\n"
-    "          \"default\" : Use the default schedule, or schedule defined by\n"
-    "                      the environment variable OMP_SCHEDULE.\n" // Note: there are meta-characters in the above so this line does not line up here, but does in the output
+    "          \"default\" : Use the schedule defined by the environment variable\n"
+    "                      OMP_SCHEDULE, or static if it is not set.\n" // Note: there are meta-characters in the above so this line does not line up here, but does in the output
     "          \"static\"  : Use OpenMP static schedule.\n"
     "          \"dynamic\" : Use OpenMP dynamic schedule.\n"
     "          \"guided\"  : Use OpenMP quided schedule.\n"
     "          \"auto\"    : Use OpenMP auto schedule.\n"
+    "          \"static-steal\" : Equal contiguous shares per thread, handed out\n"
+    "                           in chunks. Idle threads steal half of another\n"
+    "                           thread's remaining share.\n"
+    "          \"weighted\" : Contiguous shares per thread, proportional to each\n"
+    "                       thread's throughput measured in previous loops.\n"
     "        Default: \"default\"\n\n"
     "    -c <unsigned int>\n"
-    "        Set OpenMP chunk size.\n"
+    "        Set OpenMP chunk size, or static-steal chunk size (default is a\n"
+    "        sixteenth of the initial share).\n"
     "        Default: %d (system default)\n\n"
     "    -o <loop order>\n"
     "        Set loop ordering method.\n"
@@ -260,7 +1249,121 @@ program_context_t program_init( int argc, char** argv ){
     "          \"default\"  : Iterate over indices in the default implementation order.\n"
     "          \"indirect\" : Iterate over indices in ascending order (ignoring parallelism order) though an indirection array.\n"
     "          \"random\"   : Iterate over indices in random order through an indirection array.\n"
+    "          \"feistel\"  : Iterate over indices in random order, computed with a keyed\n"
+    "                       bijection (Feistel network) instead of stored.\n"
+    "          \"reverse\"  : Iterate over indices in descending order through an indirection array.\n"
+    "          \"strided\"  : Iterate over indices with a stride of -B elements, starting over\n"
+    "                       from the next offset at the end, through an indirection array.\n"
+    "          \"block-random\"  : Iterate over blocks of -B elements in order, and in\n"
+    "                            random order within each block.\n"
+    "          \"block-shuffle\" : Iterate over blocks of -B elements in random order, and\n"
+    "                            in order within each block.\n"
+    "          \"page-random\"   : \"block-shuffle\" with blocks of one memory page.\n"
     "        Default : \"default\"\n\n"
+    "    -B <unsigned int>\n"
+    "        Set the block size (or stride) in elements of the \"strided\",\n"
+    "        \"block-random\" and \"block-shuffle\" loop orders.\n"
+    "        Default: 8 for \"strided\" (one element per cache line), 4096 for the\n"
+    "        block orders\n\n"
+    "    -x <stencil kernel>\n"
+    "        Set local stencil kernel used with the default loop order.\n"
+    "        Values:\n"
+    "          \"auto\"    : Use the widest kernel supported by this machine.\n"
+    "          \"generic\" : Use the generic loop, testing for boundaries at every element.\n"
+    "          \"scalar\"  : Peel boundaries and use a branch-free scalar interior.\n"
+    "          \"avx2\"    : Peel boundaries and use an AVX2 interior.\n"
+    "          \"avx512\"  : Peel boundaries and use an AVX-512 interior.\n"
+    "          \"templated\" : Use the templated C++ core for init, stencil and sum,\n"
+    "                        in every loop order but \"feistel\".\n"
+    "        Default: \"auto\"\n\n"
+    "    -K <stencil operator>\n"
+    "        Set the update computed from the window A[i-r..i+r] (r is 1 unless\n"
+    "        -g is given). Operators other than \"maxmin\" (and -I) use an\n"
+    "        OpenMP SIMD kernel rather than -x, and require the default loop\n"
+    "        order, the \"double\" precision and the distributed array (-D 1).\n"
+    "        Values:\n"
+    "          \"maxmin\"         : max( window ) / (1 + abs( min( window ) ) ).\n"
+    "          \"jacobi\"         : Mean of the window (3-point average).\n"
+    "          \"weighted\"       : Binomial weights over the window (weighted\n"
+    "                             5-point with -g 2).\n"
+    "          \"transcendental\" : Mean of sin( A ) * exp( -abs( A ) ).\n"
+    "        Default: \"maxmin\"\n\n"
+    "    -I <unsigned int>\n"
+    "        Set the arithmetic intensity dial: repeat this many (identity)\n"
+    "        multiply-adds on every update, 2 flops each, without loading more.\n"
+    "        Default: 0\n\n"
+    "    -p <precision>\n"
+    "        Set the type the array is stored and the stencil computed in. Sums\n"
+    "        are always accumulated and reduced in double. With a precision\n"
+    "        other than \"double\", the run is repeated in double, and the\n"
+    "        deviation of the mean sum from it is reported.\n"
+    "        Requires the \"templated\" stencil kernel (the default then) and\n"
+    "        the compact layout.\n"
+    "        Values:\n"
+    "          \"double\" : 8 bytes per element.\n"
+    "          \"float\"  : 4 bytes per element.\n"
+    "          \"bf16\"   : 2 bytes per element (bfloat16), computed in float.\n"
+    "          \"long-double\" : long double (16 bytes per element on x86-64),\n"
+    "                          summed locally in long double.\n"
+    "        Default: \"double\"\n\n"
+    "    -f\n"
+    "        Fuse stencil and sum into a single pass over the local array.\n\n"
+    "    -r <reduction strategy>\n"
+    "        Set how local sums are reduced into the distributed sum.\n"
+    "        Values:\n"
+    "          \"gather\"     : MPI_Gather local sums, primary sums them.\n"
+    "          \"reduce\"     : MPI_Reduce to the primary.\n"
+    "          \"allreduce\"  : MPI_Allreduce to all ranks.\n"
+    "          \"iallreduce\" : MPI_Iallreduce to all ranks, completed during the\n"
+    "                         next iteration's stencil.\n"
+    "        Default: \"gather\"\n\n"
+    "    -R\n"
+    "        Sum reproducibly: the sum is bitwise identical for any number of\n"
+    "        ranks and threads, distribution and loop schedule. Elements are\n"
+    "        pre-rounded against the global maximum and summed exactly in\n"
+    "        integers, with two MPI_Allreduce per sum (replacing -r, except\n"
+    "        \"iallreduce\"). Its overhead over the plain sum is reported.\n"
+    "        Requires the \"double\" precision, and no temporal tiling.\n\n"
+    "    -e <halo exchange>\n"
+    "        Set how end values are exchanged with neighboring ranks.\n"
+    "        Values:\n"
+    "          \"isend\"      : Set up MPI_Isend/MPI_Irecv every stencil.\n"
+    "          \"persistent\" : Create persistent requests once, and use\n"
+    "                         MPI_Startall/MPI_Waitall every stencil.\n"
+    "        Default: \"isend\"\n\n"
+    "    -g <unsigned int>\n"
+    "        Use the ghost-cell padded layout with the given (non-zero) stencil\n"
+    "        radius. Halos are received directly into the ghost cells, and all\n"
+    "        elements are computed by the same kernel.\n"
+    "        Default: compact layout (no ghost cells) with stencil radius 1\n\n"
+    "    -k <unsigned int>\n"
+    "        Set temporal blocking depth: exchange halos of depth radius*k every k\n"
+    "        stencils, redundantly computing the overlap in between. Uses the\n"
+    "        ghost-cell layout (with radius 1 unless -g is given).\n"
+    "        Default: 1\n\n"
+    "    -T <unsigned int or \"auto\">\n"
+    "        Compute each temporal block (-k) in one cache-blocked sweep, using\n"
+    "        diamond tiles of at least this many elements scheduled across\n"
+    "        OpenMP threads. \"auto\" sizes tiles to half the L2 cache.\n"
+    "        Requires -k greater than 1 and the default loop order.\n"
+    "        Default: 0 (no temporal tiling)\n\n"
+    "    -P <unsigned int or \"sweep\">\n"
+    "        Prefetch the elements of indirection-array loops this many\n"
+    "        iterations ahead. \"sweep\" times the local stencil and sum at a\n"
+    "        range of distances before the iterations, reports them, and uses\n"
+    "        the fastest. Requires -o \"indirect\" or \"random\".\n"
+    "        Default: 0 (no prefetching)\n\n"
+    "    -b <unsigned int>\n"
+    "        Before the iterations, probe the memory bandwidth with copy, triad\n"
+    "        and random-gather loops over arrays of this many elements per rank,\n"
+    "        and report the kernels' bandwidth as a percent of it.\n"
+    "        Default: 0 (no probe)\n\n"
+    "    -H\n"
+    "        Count cycles, instructions, cache misses and dTLB misses of every\n"
+    "        thread with perf_event_open, in user space only (no privileges\n"
+    "        needed up to perf_event_paranoid 2), and report them for the\n"
+    "        stencil, sum and communication phases. Events that cannot be\n"
+    "        opened are reported and skipped.\n\n"
     "    -v <string or int>\n"
     "        Set verbosity level.\n"
     "        Values:\n"
@@ -283,7 +1386,7 @@ program_context_t program_init( int argc, char** argv ){
     exit(-1); \
   }
 
-  char* options = "hN:n:i:d:wt:l:c:o:v:qs";
+  char* options = "hN:n:i:d:D:wt:l:c:o:B:x:K:I:p:fr:Re:g:k:T:P:b:Hv:qs";
   char flag_char;
   opterr = 0;
   while( ( flag_char = getopt( argc, argv, options ) ) != -1 ){
@@ -318,6 +1421,38 @@ program_context_t program_init( int argc, char** argv ){
       }
       break;
 
+      case 'D': {
+        if( isunsignedinteger( optarg ) ){
+          n_dims = atoi( optarg );
+          if( n_dims < 1 || n_dims > 3 ){
+            print_help_error( flag_char, optarg );
+          }
+          explicit_grid_dims = false;
+        } else {
+          // Explicit extents, e.g. 512x512 or 64x64x64
+          size_t extents[3];
+          int n_extents = 0;
+          const char* str = optarg;
+          char* str_end = optarg;
+          while( n_extents < 3 && isdigit( *str ) ){
+            extents[n_extents] = strtoul( str, &str_end, 10 );
+            if( extents[n_extents] == 0 ) break;
+            n_extents += 1;
+            if( *str_end != 'x' ) break;
+            str = str_end + 1;
+          }
+          if( n_extents < 2 || *str_end != '\0' ){
+            print_help_error( flag_char, optarg );
+          }
+          n_dims = n_extents;
+          for( int dim = 0; dim < 3; ++dim ){
+            grid_dims[dim] = ( dim < 3 - n_dims ) ? 1 : extents[dim - ( 3 - n_dims )];
+          }
+          explicit_grid_dims = true;
+        }
+      }
+      break;
+
       case 'w': {
         synchronize_at_end_of_distributed_array_operations = true;
       }
@@ -333,12 +1468,16 @@ program_context_t program_init( int argc, char** argv ){
       break;
 
       case 'l': {
+        loop_schedule_type = loop_schedule_openmp;
         // Do all string comparisons
         if(      strcmp( "default", optarg ) == 0 ) omp_schedule = default_omp_schedule;
         else if( strcmp( "static",  optarg ) == 0 ) omp_schedule = omp_sched_static;
         else if( strcmp( "dynamic", optarg ) == 0 ) omp_schedule = omp_sched_dynamic;
         else if( strcmp( "guided",  optarg ) == 0 ) omp_schedule = omp_sched_guided;
         else if( strcmp( "auto",    optarg ) == 0 ) omp_schedule = omp_sched_auto;
+        // Miniapp schedules, OpenMP runtime schedule is left at static
+        else if( strcmp( "static-steal", optarg ) == 0 ){ omp_schedule = omp_sched_static; loop_schedule_type = loop_schedule_static_steal; }
+        else if( strcmp( "weighted",     optarg ) == 0 ){ omp_schedule = omp_sched_static; loop_schedule_type = loop_schedule_weighted; }
         else {
           print_help_error( flag_char, optarg );
         }
@@ -360,92 +1499,375 @@ program_context_t program_init( int argc, char** argv ){
         if(      strcmp( "default",  optarg ) == 0 ) iteration_order_type = iteration_order_regular_order;
         else if( strcmp( "indirect", optarg ) == 0 ) iteration_order_type = iteration_order_ascending_indirect_order;
         else if( strcmp( "random",   optarg ) == 0 ) iteration_order_type = iteration_order_random_order;
+        else if( strcmp( "feistel",  optarg ) == 0 ) iteration_order_type = iteration_order_feistel_order;
+        else if( strcmp( "reverse",       optarg ) == 0 ) iteration_order_type = iteration_order_reverse_order;
+        else if( strcmp( "strided",       optarg ) == 0 ) iteration_order_type = iteration_order_strided_order;
+        else if( strcmp( "block-random",  optarg ) == 0 ) iteration_order_type = iteration_order_block_random_order;
+        else if( strcmp( "block-shuffle", optarg ) == 0 ) iteration_order_type = iteration_order_block_shuffle_order;
+        else if( strcmp( "page-random",   optarg ) == 0 ) iteration_order_type = iteration_order_page_random_order;
         else {
           print_help_error( flag_char, optarg );
         }
       }
       break;
 
-      case 'h': {
-        printf( usage_fmt_string, default_N, default_omp_num_threads, default_omp_chunk_size );
-        exit(-1);
-        program_finalize();
-        exit(0);
+      case 'x': {
+        // Do all string comparisons
+        if(      strcmp( "auto",    optarg ) == 0 ) stencil_kernel_type = stencil_kernel_auto;
+        else if( strcmp( "generic", optarg ) == 0 ) stencil_kernel_type = stencil_kernel_generic;
+        else if( strcmp( "scalar",  optarg ) == 0 ) stencil_kernel_type = stencil_kernel_scalar;
+        else if( strcmp( "avx2",    optarg ) == 0 ) stencil_kernel_type = stencil_kernel_avx2;
+        else if( strcmp( "avx512",  optarg ) == 0 ) stencil_kernel_type = stencil_kernel_avx512;
+        else if( strcmp( "templated", optarg ) == 0 ) stencil_kernel_type = stencil_kernel_templated;
+        else {
+          print_help_error( flag_char, optarg );
+        }
       }
       break;
 
-      case 'v': {
-        // Do all string comparisons
-        if(      strcmp( "normal", optarg ) == 0 ) verbosity = verbosity_normal;
-        else if( strcmp( "more",   optarg ) == 0 ) verbosity = verbosity_more;
-        else if( strcmp( "less",   optarg ) == 0 ) verbosity = verbosity_less;
-        else if( strcmp( "errors", optarg ) == 0 ) verbosity = verbosity_errors;
-        else if( strcmp( "debug",  optarg ) == 0 ) verbosity = verbosity_debug;
-        else if( strcmp( "all",    optarg ) == 0 ) verbosity = verbosity_all;
-        // Integer fallback if necessary
-        else {
-          if( isinteger( optarg ) ){
-            verbosity = atoi( optarg );
-          } else {
-            print_help_error( flag_char, optarg );
-          }
+      case 'K': {
+        if( ! find_stencil_operator( optarg, &stencil_operator_type ) ){
+          print_help_error( flag_char, optarg );
         }
       }
       break;
 
-      case 'q': {
-        verbosity = verbosity_less;
+      case 'I': {
+        if( isunsignedinteger( optarg ) ){
+          stencil_intensity = atoi( optarg );
+        } else {
+          print_help_error( flag_char, optarg );
+        }
       }
       break;
 
-      case 's': {
-        verbosity = verbosity_errors;
+      case 'f': {
+        fuse_stencil_and_sum = true;
       }
       break;
 
-      case '?': {
-        char* option_ptr = strchr( options, optopt );
-        // option is NOT in option string
-        if( option_ptr == NULL ){
-          if( isprint( optopt ) ){
-            fprintf( stderr, "Unknown option `-%c'.\n", optopt );
-          } else {
-            fprintf( stderr, "Unknown option character `\\x%x'.\n", optopt );
-          }
-        }
-        // Option is in option string
+      case 'R': {
+        reproducible_sum = true;
+      }
+      break;
+
+      case 'p': {
+        if(      strcmp( "double", optarg ) == 0 ) element_type = element_double;
+        else if( strcmp( "float",  optarg ) == 0 ) element_type = element_float;
+        else if( strcmp( "bf16",   optarg ) == 0 ) element_type = element_bfloat16;
+        else if( strcmp( "long-double", optarg ) == 0 ) element_type = element_long_double;
         else {
-          // Get position in option string to test if it's followed by a colon.
-          int opt_pos = option_ptr - options;
-          if( 0 <= opt_pos && opt_pos < strlen( options ) ){
-            // Safely check next character to see if is colon
-            if( opt_pos + 1 < strlen( options ) && options[opt_pos+1] == ':' ){
-              fprintf( stderr, "Option -%c requires an argument.\n", optopt );
-            } else {
-              fprintf( stderr, "Internal Error: Unknown issue using flag '%1$c' (''\\x%1$x').\n", optopt );
-            }
-          }
-          // Note: This should never happen
-          else {
-            if( isprint( optopt ) ){
-              fprintf( stderr, "Internal Error: Flag character '%1$c' (''\\x%1$x') somehow in options str, but outside the string's bounds ( %2$d not in [0,%3$lu) ).\n", optopt, opt_pos, strlen( options ) );
-            } else {
-              fprintf( stderr, "Internal Error: Unprintable flag character '\\x%1$x' somehow in options str, but outside the string's bounds ( %2$d not in [0,%3$lu) ).\n", optopt, opt_pos, strlen( options ) );
-            }
-          }
+          print_help_error( flag_char, optarg );
         }
-      } // case '?'
-      // Note: Fallthrough
-
-      default: {
-        fprintf( stderr, usage_fmt_string, default_N, default_omp_num_threads, default_omp_chunk_size );
-        exit( -1 );
       }
-    } // switch
-  } // while getopt
+      break;
+
+      case 'r': {
+        // Do all string comparisons
+        if(      strcmp( "gather",     optarg ) == 0 ) reduction_type = reduction_gather;
+        else if( strcmp( "reduce",     optarg ) == 0 ) reduction_type = reduction_reduce;
+        else if( strcmp( "allreduce",  optarg ) == 0 ) reduction_type = reduction_allreduce;
+        else if( strcmp( "iallreduce", optarg ) == 0 ) reduction_type = reduction_iallreduce;
+        else {
+          print_help_error( flag_char, optarg );
+        }
+      }
+      break;
+
+      case 'e': {
+        // Do all string comparisons
+        if(      strcmp( "isend",      optarg ) == 0 ) halo_exchange_type = halo_exchange_isend;
+        else if( strcmp( "persistent", optarg ) == 0 ) halo_exchange_type = halo_exchange_persistent;
+        else {
+          print_help_error( flag_char, optarg );
+        }
+      }
+      break;
+
+      case 'g': {
+        if( isunsignedinteger( optarg ) && atoi( optarg ) > 0 ){
+          ghost_layout = true;
+          stencil_radius = atoi( optarg );
+        } else {
+          print_help_error( flag_char, optarg );
+        }
+      }
+      break;
+
+      case 'k': {
+        if( isunsignedinteger( optarg ) && atoi( optarg ) > 0 ){
+          temporal_block_depth = atoi( optarg );
+        } else {
+          print_help_error( flag_char, optarg );
+        }
+      }
+      break;
+
+      case 'B': {
+        if( isunsignedinteger( optarg ) && atol( optarg ) > 0 ){
+          iteration_order_block_elts = atol( optarg );
+        } else {
+          print_help_error( flag_char, optarg );
+        }
+      }
+      break;
+
+      case 'P': {
+        if( strcmp( "sweep", optarg ) == 0 ){
+          prefetch_sweep = true;
+        } else if( isunsignedinteger( optarg ) ){
+          prefetch_distance = atol( optarg );
+          prefetch_sweep = false;
+        } else {
+          print_help_error( flag_char, optarg );
+        }
+      }
+      break;
+
+      case 'b': {
+        if( isunsignedinteger( optarg ) ){
+          probe_elts = atol( optarg );
+        } else {
+          print_help_error( flag_char, optarg );
+        }
+      }
+      break;
+
+      case 'H': {
+        hw_counters = true;
+      }
+      break;
+
+      case 'T': {
+        if( strcmp( "auto", optarg ) == 0 ){
+          // Two buffers of the tile should fit in half of L2
+          long l2_bytes = sysconf( _SC_LEVEL2_CACHE_SIZE );
+          if( l2_bytes <= 0 ) l2_bytes = 1 << 20;
+          temporal_tile_elts = l2_bytes / ( 2 * 2 * sizeof(double) );
+        } else if( isunsignedinteger( optarg ) ){
+          temporal_tile_elts = atol( optarg );
+        } else {
+          print_help_error( flag_char, optarg );
+        }
+      }
+      break;
+
+      case 'h': {
+        printf( usage_fmt_string, default_N, default_omp_num_threads, default_omp_chunk_size );
+        exit(-1);
+        program_finalize();
+        exit(0);
+      }
+      break;
+
+      case 'v': {
+        // Do all string comparisons
+        if(      strcmp( "normal", optarg ) == 0 ) verbosity = verbosity_normal;
+        else if( strcmp( "more",   optarg ) == 0 ) verbosity = verbosity_more;
+        else if( strcmp( "less",   optarg ) == 0 ) verbosity = verbosity_less;
+        else if( strcmp( "errors", optarg ) == 0 ) verbosity = verbosity_errors;
+        else if( strcmp( "debug",  optarg ) == 0 ) verbosity = verbosity_debug;
+        else if( strcmp( "all",    optarg ) == 0 ) verbosity = verbosity_all;
+        // Integer fallback if necessary
+        else {
+          if( isinteger( optarg ) ){
+            verbosity = atoi( optarg );
+          } else {
+            print_help_error( flag_char, optarg );
+          }
+        }
+      }
+      break;
+
+      case 'q': {
+        verbosity = verbosity_less;
+      }
+      break;
+
+      case 's': {
+        verbosity = verbosity_errors;
+      }
+      break;
+
+      case '?': {
+        char* option_ptr = strchr( options, optopt );
+        // option is NOT in option string
+        if( option_ptr == NULL ){
+          if( isprint( optopt ) ){
+            fprintf( stderr, "Unknown option `-%c'.\n", optopt );
+          } else {
+            fprintf( stderr, "Unknown option character `\\x%x'.\n", optopt );
+          }
+        }
+        // Option is in option string
+        else {
+          // Get position in option string to test if it's followed by a colon.
+          int opt_pos = option_ptr - options;
+          if( 0 <= opt_pos && opt_pos < strlen( options ) ){
+            // Safely check next character to see if is colon
+            if( opt_pos + 1 < strlen( options ) && options[opt_pos+1] == ':' ){
+              fprintf( stderr, "Option -%c requires an argument.\n", optopt );
+            } else {
+              fprintf( stderr, "Internal Error: Unknown issue using flag '%1$c' (''\\x%1$x').\n", optopt );
+            }
+          }
+          // Note: This should never happen
+          else {
+            if( isprint( optopt ) ){
+              fprintf( stderr, "Internal Error: Flag character '%1$c' (''\\x%1$x') somehow in options str, but outside the string's bounds ( %2$d not in [0,%3$lu) ).\n", optopt, opt_pos, strlen( options ) );
+            } else {
+              fprintf( stderr, "Internal Error: Unprintable flag character '\\x%1$x' somehow in options str, but outside the string's bounds ( %2$d not in [0,%3$lu) ).\n", optopt, opt_pos, strlen( options ) );
+            }
+          }
+        }
+      } // case '?'
+      // Note: Fallthrough
+
+      default: {
+        fprintf( stderr, usage_fmt_string, default_N, default_omp_num_threads, default_omp_chunk_size );
+        exit( -1 );
+      }
+    } // switch
+  } // while getopt
 
   #undef print_help_error
 
+  // Temporal blocking needs ghost cells to hold the deep halos
+  if( temporal_block_depth > 1 ){
+    ghost_layout = true;
+  }
+
+  // Temporal tiling sweeps whole temporal blocks in the default order
+  if( temporal_tile_elts > 0 && temporal_block_depth <= 1 ){
+    fprintf( stderr, "Error: temporal tiling (-T) requires a temporal blocking depth (-k) greater than 1\n" );
+    exit(-1);
+  }
+  if( temporal_tile_elts > 0 && iteration_order_type != iteration_order_regular_order ){
+    fprintf( stderr, "Error: temporal tiling (-T) requires the default loop order (-o \"default\")\n" );
+    exit(-1);
+  }
+
+  // Block size (or stride) of the parameterized loop orders
+  if( iteration_order_type == iteration_order_page_random_order ){
+    long page_bytes = sysconf( _SC_PAGESIZE );
+    if( page_bytes <= 0 ) page_bytes = 4096;
+    iteration_order_block_elts = max2( page_bytes / sizeof(double), 1 );
+  } else if( iteration_order_block_elts == 0 ){
+    iteration_order_block_elts = ( iteration_order_type == iteration_order_strided_order ) ? 8 : 4096;
+  }
+
+  // Prefetching is of the indirection arrays' indices
+  if( ( prefetch_distance > 0 || prefetch_sweep ) && ! is_iteration_order_indirect( iteration_order_type ) ){
+    fprintf( stderr, "Error: prefetching (-P) requires a loop order (-o) through indirection arrays\n" );
+    exit(-1);
+  }
+
+  // Other precisions are only implemented by the templated core, in the compact layout
+  if( element_type != element_double ){
+    if( stencil_kernel_type == stencil_kernel_auto ){
+      stencil_kernel_type = stencil_kernel_templated;
+    } else if( stencil_kernel_type != stencil_kernel_templated ){
+      fprintf( stderr, "Error: precision \"%s\" (-p) requires the \"templated\" stencil kernel (-x)\n", element_type_name( element_type ) );
+      exit(-1);
+    }
+    if( ghost_layout ){
+      fprintf( stderr, "Error: precision \"%s\" (-p) requires the compact layout (no -g, -k or -T)\n", element_type_name( element_type ) );
+      exit(-1);
+    }
+  }
+
+  // Grids are square (cubic) unless given, and only implement the plain configuration
+  if( n_dims > 1 ){
+    if( ! explicit_grid_dims ){
+      size_t side = (size_t) pow( N, 1.0 / n_dims );
+      while( pow( side + 1, n_dims ) <= N ) side += 1;
+      while( side > 1 && pow( side, n_dims ) > N ) side -= 1;
+      for( int dim = 0; dim < 3; ++dim ){
+        grid_dims[dim] = ( dim < 3 - n_dims ) ? 1 : side;
+      }
+    }
+
+    const size_t grid_elts = grid_dims[0] * grid_dims[1] * grid_dims[2];
+    if( grid_elts > INT_MAX ){
+      fprintf( stderr, "Error: grid of %lu elements is too large\n", grid_elts );
+      exit(-1);
+    }
+    N = grid_elts;
+
+    if( iteration_order_type != iteration_order_regular_order ){
+      fprintf( stderr, "Error: grids (-D) require the default loop order (-o \"default\")\n" );
+      exit(-1);
+    }
+    if( ghost_layout ){
+      fprintf( stderr, "Error: grids (-D) have their own ghost cells, and cannot be combined with -g, -k or -T\n" );
+      exit(-1);
+    }
+    if( element_type != element_double || stencil_kernel_type == stencil_kernel_templated ){
+      fprintf( stderr, "Error: grids (-D) require the \"double\" precision (-p), and no templated kernel (-x)\n" );
+      exit(-1);
+    }
+    if( reproducible_sum ){
+      fprintf( stderr, "Error: grids (-D) cannot be combined with the reproducible sum (-R)\n" );
+      exit(-1);
+    }
+  }
+
+  // The reproducible sum reads the double array itself, and returns at once
+  if( reproducible_sum ){
+    if( element_type != element_double ){
+      fprintf( stderr, "Error: the reproducible sum (-R) requires the \"double\" precision (-p)\n" );
+      exit(-1);
+    }
+    if( temporal_tile_elts > 0 ){
+      fprintf( stderr, "Error: the reproducible sum (-R) cannot be combined with temporal tiling (-T)\n" );
+      exit(-1);
+    }
+    if( reduction_type == reduction_iallreduce ){
+      fprintf( stderr, "Error: the reproducible sum (-R) cannot be deferred (-r \"iallreduce\")\n" );
+      exit(-1);
+    }
+  }
+
+  // Other operators are only implemented by the SIMD kernels of the default order
+  if( stencil_operator_type != stencil_operator_maxmin || stencil_intensity > 0 ){
+    if( iteration_order_type != iteration_order_regular_order ){
+      fprintf( stderr, "Error: stencil operator \"%s\" (-K, -I) requires the default loop order (-o \"default\")\n", stencil_operators[stencil_operator_type].name );
+      exit(-1);
+    }
+    if( stencil_kernel_type == stencil_kernel_generic || stencil_kernel_type == stencil_kernel_templated || element_type != element_double ){
+      fprintf( stderr, "Error: stencil operator \"%s\" (-K, -I) requires the \"double\" precision (-p), and no \"generic\" or \"templated\" kernel (-x)\n", stencil_operators[stencil_operator_type].name );
+      exit(-1);
+    }
+    if( n_dims > 1 ){
+      fprintf( stderr, "Error: stencil operator \"%s\" (-K, -I) cannot be combined with grids (-D)\n", stencil_operators[stencil_operator_type].name );
+      exit(-1);
+    }
+  }
+
+  // The templated core iterates through stored indices only
+  if( stencil_kernel_type == stencil_kernel_templated && iteration_order_type == iteration_order_feistel_order ){
+    fprintf( stderr, "Error: stencil kernel \"templated\" does not support the \"feistel\" loop order\n" );
+    exit(-1);
+  }
+
+  // Resolve stencil kernel against what this machine supports
+  bool supports_avx2 = false;
+  bool supports_avx512 = false;
+#if MINIAPP_X86_SIMD
+  __builtin_cpu_init();
+  supports_avx2   = __builtin_cpu_supports( "avx2" );
+  supports_avx512 = __builtin_cpu_supports( "avx512f" );
+#endif
+  if( stencil_kernel_type == stencil_kernel_auto ){
+    if(      supports_avx512 ) stencil_kernel_type = stencil_kernel_avx512;
+    else if( supports_avx2   ) stencil_kernel_type = stencil_kernel_avx2;
+    else                       stencil_kernel_type = stencil_kernel_scalar;
+  } else if( ( stencil_kernel_type == stencil_kernel_avx2   && ! supports_avx2   )
+          || ( stencil_kernel_type == stencil_kernel_avx512 && ! supports_avx512 ) ){
+    fprintf( stderr, "Error: stencil kernel \"%s\" is not supported on this machine\n", stencil_kernel_name( stencil_kernel_type ) );
+    exit(-1);
+  }
+
   // Create get a new random number seed for this rank
   // initialize srand to something all ranks may have
   srand( time(NULL) );
@@ -458,285 +1880,2251 @@ program_context_t program_init( int argc, char** argv ){
   srand( rank_seed );
 
 
-  // Create return/memcopy object
-  program_context_t ret_obj = {
-    .initialized           = true,
+  // Create return/memcopy object
+  program_context_t ret_obj = {
+    .initialized           = true,
+
+    .N                     = N,
+    .n_dims                = n_dims,
+    .grid_dims             = { grid_dims[0], grid_dims[1], grid_dims[2] },
+    .iterations            = iterations,
+    .synchronize_at_end_of_distributed_array_operations = synchronize_at_end_of_distributed_array_operations,
+    .verbosity             = verbosity,
+    .distribution_type     = distribution_type,
+    .iteration_order_type  = iteration_order_type,
+    .iteration_order_block_elts = iteration_order_block_elts,
+
+    .rank                  = rank,
+    .n_ranks               = n_ranks,
+    .primary_rank          = 0, // rank 0 is always the primary rank
+    .comm                  = comm,
+    .omp_num_threads       = omp_num_threads,
+
+    .omp_loop_schedule     = omp_schedule,
+    .omp_chunk_size        = omp_chunk_size,
+    .loop_schedule_type    = loop_schedule_type,
+    .stencil_kernel_type   = stencil_kernel_type,
+    .stencil_operator_type = stencil_operator_type,
+    .stencil_intensity     = stencil_intensity,
+    .element_type          = element_type,
+    .fuse_stencil_and_sum  = fuse_stencil_and_sum,
+    .reduction_type        = reduction_type,
+    .reproducible_sum      = reproducible_sum,
+    .halo_exchange_type    = halo_exchange_type,
+    .ghost_layout          = ghost_layout,
+    .stencil_radius        = stencil_radius,
+    .temporal_block_depth  = temporal_block_depth,
+    .temporal_tile_elts    = temporal_tile_elts,
+    .prefetch_distance     = prefetch_distance,
+    .prefetch_sweep        = prefetch_sweep,
+    .probe_elts            = probe_elts,
+    .hw_counters           = hw_counters,
+
+    .seed                  = rank_seed
+  };
+
+  // I really want all members of program_context_t to be const,
+  // So we memcpy it into place to force the overwrite.
+  memcpy( &global_program_context, &ret_obj, sizeof(program_context_t) );
+
+  int compare = memcmp( &ret_obj, &global_program_context, sizeof(program_context_t) );
+  if( compare != 0 ){
+    fprintf( stderr, "Internal Error: mock program context (@%p) and global_program_context (@%p) are unequal (%d)\n", &ret_obj, &global_program_context, compare );
+    exit(-1);
+  }
+
+  // Set the schedule here, every loop picks it up through schedule(runtime)
+  // (see scheduled_for)
+  omp_set_schedule( global_program_context.omp_loop_schedule, global_program_context.omp_chunk_size );
+
+  omp_set_num_threads( global_program_context.omp_num_threads );
+
+  init_loop_schedule( );
+
+  if( global_program_context.hw_counters ){
+    init_hw_counters( );
+  }
+
+  if( global_program_context.reproducible_sum ){
+    init_reproducible_sum( );
+  }
+
+  global_prefetch_distance = global_program_context.prefetch_distance;
+
+  init_stencil_operator( );
+
+  return ret_obj;
+}
+
+
+// Philox4x32-10 counter-based random number generator (Salmon et al., SC'11)
+// Every (counter, key) pair maps to an independent block of four 32-bit random
+// numbers, so threads draw any part of a random sequence directly, without
+// shared state, and results do not depend on the number of threads.
+typedef struct { uint32_t v[4]; } philox4x32_counter_t;
+typedef struct { uint32_t v[2]; } philox4x32_key_t;
+
+// \brief Philox4x32-10 block function
+// \param counter counter to encrypt
+// \param key key (stream) to encrypt it with
+// \return four 32-bit random numbers
+static inline philox4x32_counter_t philox4x32( philox4x32_counter_t counter, philox4x32_key_t key ){
+  for( int round = 0; round < 10; ++round ){
+    const uint64_t product0 = (uint64_t) 0xD2511F53u * counter.v[0];
+    const uint64_t product1 = (uint64_t) 0xCD9E8D57u * counter.v[2];
+    const philox4x32_counter_t next = {{
+      (uint32_t)( product1 >> 32 ) ^ counter.v[1] ^ key.v[0],
+      (uint32_t)  product1,
+      (uint32_t)( product0 >> 32 ) ^ counter.v[3] ^ key.v[1],
+      (uint32_t)  product0
+    }};
+    counter = next;
+    key.v[0] += 0x9E3779B9u;
+    key.v[1] += 0xBB67AE85u;
+  }
+  return counter;
+}
+
+// \brief Unbiased random integer below a bound, drawn from a Philox stream
+// Uses Lemire's multiply-shift with rejection, so there is no modulo bias.
+// \param key stream to draw from
+// \param index index of the draw in the stream
+// \param pass distinguishes several sequences of draws in the same stream
+// \param bound exclusive upper bound, greater than 0
+// \return random integer in [0, bound)
+static inline uint64_t philox_uniform_below( const philox4x32_key_t key, const uint64_t index, const uint32_t pass, const uint64_t bound ){
+  const uint64_t threshold = ( -bound ) % bound;
+  for( uint32_t attempt = 0; ; ++attempt ){
+    const philox4x32_counter_t counter = {{ (uint32_t) index, (uint32_t)( index >> 32 ), pass, attempt }};
+    const philox4x32_counter_t random = philox4x32( counter, key );
+    // Two 64-bit candidates per block
+    for( int half = 0; half < 2; ++half ){
+      const uint64_t x = ( (uint64_t) random.v[2*half] << 32 ) | random.v[2*half+1];
+      const unsigned __int128 product = (unsigned __int128) x * bound;
+      if( (uint64_t) product >= threshold ) return (uint64_t)( product >> 64 );
+    }
+  }
+}
+
+// \brief Fisher-Yates shuffle a range of an array
+// Note: draws are indexed by position, so do not depend on where the range starts.
+// Note: when not applying the permutation, goes through the same motions
+// (as the old serial shuffle did), but swaps write back the values read,
+// through volatile pointers so they are not optimized away.
+// \param array array to shuffle a range of
+// \param begin first index of the range
+// \param end one past the last index of the range
+// \param key random stream to use
+// \param apply whether to actually permute the range
+static inline void fisher_yates_range( size_t* array, const size_t begin, const size_t end, const philox4x32_key_t key, const bool apply ){
+  for( size_t j = end; j > begin + 1; --j ){
+    const size_t k = begin + philox_uniform_below( key, j - 1, 1, j - begin );
+    const size_t j_value = ((size_t volatile*)array)[j - 1];
+    const size_t k_value = ((size_t volatile*)array)[k];
+    if( apply ){
+      ((size_t volatile*)array)[j - 1] = k_value;
+      ((size_t volatile*)array)[k]     = j_value;
+    } else {
+      ((size_t volatile*)array)[j - 1] = j_value;
+      ((size_t volatile*)array)[k]     = k_value;
+    }
+  }
+}
+
+// Scatter shuffle sizes
+// Buckets are Fisher-Yates shuffled by one thread each, so should fit in cache,
+// but the scatter keeps a count per (source block, bucket) pair.
+#define SHUFFLE_BUCKET_ELTS ( 1 << 16 )
+#define SHUFFLE_MAX_BUCKETS 1024
+
+// \brief Randomly permute an array in parallel
+// Scatter shuffle (Sanders, 1998): every element is sent to a uniformly random
+// bucket, keeping the order of arrival, then every bucket is Fisher-Yates
+// shuffled on its own. This gives a uniformly random permutation, and both
+// passes run in parallel across the buckets.
+// Note: when not applying the permutation, goes through the same motions
+// but every element stays in place: elements are sent to the bucket matching
+// their position, and swaps write back the values read (see fisher_yates_range).
+// \param array array to permute
+// \param size number of elements of array
+// \param key random stream to use
+// \param apply whether to actually permute the array
+void parallel_shuffle( size_t* array, const size_t size, const philox4x32_key_t key, const bool apply ){
+  if( size < 2 ) return;
+
+  const size_t n_buckets = min2( ( size + SHUFFLE_BUCKET_ELTS - 1 ) / SHUFFLE_BUCKET_ELTS, SHUFFLE_MAX_BUCKETS );
+  // Source blocks and buckets have the same (equal share) boundaries
+  #define shuffle_block_begin( block ) ( ( size * (block) ) / n_buckets )
+
+  // Bucket of every element
+  // Note: redrawn in the scatter instead of stored, drawing is cheap
+  #define shuffle_bucket_of( i, block ) ( apply ? philox_uniform_below( key, (i), 0, n_buckets ) : (block) )
+
+  size_t* positions = (size_t*) counted_malloc( n_buckets * n_buckets * sizeof(size_t) );
+  size_t* scattered = (size_t*) counted_malloc( size * sizeof(size_t) );
+
+  // First, count the elements of each source block going to each bucket
+  #pragma omp parallel
+  scheduled_for( n_buckets, block, {
+    size_t* block_counts = &positions[block * n_buckets];
+    for( size_t bucket = 0; bucket < n_buckets; ++bucket ) block_counts[bucket] = 0;
+    for( size_t i = shuffle_block_begin( block ); i < shuffle_block_begin( block + 1 ); ++i ){
+      block_counts[shuffle_bucket_of( i, block )] += 1;
+    }
+  } );
+
+  // Second, turn the counts into each source block's position in each bucket
+  // Buckets are in order, and in each bucket the source blocks are in order
+  size_t position = 0;
+  size_t bucket_begins[n_buckets + 1];
+  for( size_t bucket = 0; bucket < n_buckets; ++bucket ){
+    bucket_begins[bucket] = position;
+    for( size_t block = 0; block < n_buckets; ++block ){
+      const size_t count = positions[block * n_buckets + bucket];
+      positions[block * n_buckets + bucket] = position;
+      position += count;
+    }
+  }
+  bucket_begins[n_buckets] = position;
+
+  // Third, scatter, and shuffle each bucket
+  #pragma omp parallel
+  {
+    scheduled_for( n_buckets, block, {
+      size_t* block_positions = &positions[block * n_buckets];
+      for( size_t i = shuffle_block_begin( block ); i < shuffle_block_begin( block + 1 ); ++i ){
+        scattered[block_positions[shuffle_bucket_of( i, block )]++] = array[i];
+      }
+    } );
+
+    scheduled_for( n_buckets, bucket, {
+      fisher_yates_range( scattered, bucket_begins[bucket], bucket_begins[bucket + 1], key, apply );
+    } );
+
+    scheduled_for( size, i, {
+      array[i] = scattered[i];
+    } );
+  }
+
+  #undef shuffle_bucket_of
+  #undef shuffle_block_begin
+
+  free( scattered );
+  free( positions );
+}
+
+// \brief Create a random permutation of [0, size) for distributed_array_t
+// \param size number of indices to permute
+// \param stream random stream of this permutation, distinct for every permutation of a rank
+// \return the permutation, to be used with feistel_permute
+feistel_permutation_t create_local_feistel_permutation( size_t size, uint32_t stream ){
+  // Smallest even number of bits covering size
+  unsigned half_bits = 1;
+  while( half_bits < 32 && ( (uint64_t) 1 << ( 2 * half_bits ) ) < size ) half_bits += 1;
+
+  feistel_permutation_t permutation = {
+    .n_elts    = size,
+    .half_bits = half_bits,
+    .half_mask = ( (uint64_t) 1 << half_bits ) - 1
+  };
+
+  // Round keys from the rank's random stream
+  const philox4x32_key_t key = {{ (uint32_t) global_program_context.seed, stream }};
+  for( int round = 0; round < FEISTEL_ROUNDS; ++round ){
+    const philox4x32_counter_t counter = {{ (uint32_t) round, 0, 2, 0 }};
+    const philox4x32_counter_t random = philox4x32( counter, key );
+    permutation.round_keys[round] = ( (uint64_t) random.v[0] << 32 ) | random.v[1];
+  }
+
+  return permutation;
+}
+
+// \brief Create proper indirection array of size for distributed_array_t given the indirection order type
+// \param size number indices of indirection array
+// \param iteration_order_type order type of indirection array
+// \param stream random stream of this array, distinct for every array of a rank
+// \returns The allocated and populated indirection array
+size_t* create_local_indirection_array( size_t size, iteration_order_type_t iteration_order_type, uint32_t stream ){
+  size_t* indirection_array = NULL;
+
+  // One of the indirection orderings
+  if( is_iteration_order_indirect( iteration_order_type ) ) {
+    indirection_array = (size_t*) counted_malloc( size * sizeof(size_t) );
+    // Fill indirection array with
+    // Note: this does not *need* to be parallel but hey whatever.
+    #pragma omp parallel
+    scheduled_for( size, i, {
+      indirection_array[i] = i;
+    } );
+
+    const philox4x32_key_t key = {{ (uint32_t) global_program_context.seed, stream }};
+    const size_t block_elts = global_program_context.iteration_order_block_elts;
+
+    switch( iteration_order_type ){
+      // Random indirection order
+      // Note: Going through the motions of the randomization, but only permute
+      // if order is random_order (see parallel_shuffle).
+      case iteration_order_ascending_indirect_order:
+      case iteration_order_random_order: {
+        parallel_shuffle( indirection_array, size, key, iteration_order_type == iteration_order_random_order );
+      }
+      break;
+
+      case iteration_order_reverse_order: {
+        #pragma omp parallel
+        scheduled_for( size, i, {
+          indirection_array[i] = size - 1 - i;
+        } );
+      }
+      break;
+
+      // Offset r of the stride has n_long_runs + 1 elements for r < n_long_runs,
+      // n_short_run_elts otherwise, and they are visited in order of r.
+      case iteration_order_strided_order: {
+        const size_t stride = min2( block_elts, size );
+        const size_t n_short_run_elts = size / stride;
+        const size_t n_long_runs = size % stride;
+        const size_t long_runs_elts = n_long_runs * ( n_short_run_elts + 1 );
+        #pragma omp parallel
+        scheduled_for( size, i, {
+          size_t offset;
+          size_t run_index;
+          if( i < long_runs_elts ){
+            offset = i / ( n_short_run_elts + 1 );
+            run_index = i % ( n_short_run_elts + 1 );
+          } else {
+            offset = n_long_runs + ( i - long_runs_elts ) / n_short_run_elts;
+            run_index = ( i - long_runs_elts ) % n_short_run_elts;
+          }
+          indirection_array[i] = offset + run_index * stride;
+        } );
+      }
+      break;
+
+      case iteration_order_block_random_order: {
+        const size_t n_blocks = ( size + block_elts - 1 ) / block_elts;
+        #pragma omp parallel
+        scheduled_for( n_blocks, block, {
+          fisher_yates_range( indirection_array, block * block_elts, min2( ( block + 1 ) * block_elts, size ), key, true );
+        } );
+      }
+      break;
+
+      // Blocks are placed in a random order. Only the last block can be short,
+      // and it shifts the blocks placed after it.
+      case iteration_order_block_shuffle_order:
+      case iteration_order_page_random_order: {
+        const size_t n_blocks = ( size + block_elts - 1 ) / block_elts;
+        const size_t last_block_elts = size - ( n_blocks - 1 ) * block_elts;
+        size_t* block_order = create_local_indirection_array( n_blocks, iteration_order_random_order, stream );
+
+        size_t last_block_slot = 0;
+        for( size_t slot = 0; slot < n_blocks; ++slot ){
+          if( block_order[slot] == n_blocks - 1 ) last_block_slot = slot;
+        }
+
+        #pragma omp parallel
+        scheduled_for( n_blocks, slot, {
+          const size_t block = block_order[slot];
+          const size_t slot_begin = slot * block_elts - ( ( slot > last_block_slot ) ? block_elts - last_block_elts : 0 );
+          const size_t block_size = ( block == n_blocks - 1 ) ? last_block_elts : block_elts;
+          for( size_t j = 0; j < block_size; ++j ){
+            indirection_array[slot_begin + j] = block * block_elts + j;
+          }
+        } );
+
+        free( block_order );
+      }
+      break;
+
+      default:
+      break;
+    }
+  } // if global_program_context.iteration_order_type ...
+
+  return indirection_array;
+}
+
+// \brief Create a copy of an indirection array with 32-bit indices
+// \param indirection_array indirection array, all indices must be below 2^32
+// \param size number of indices of indirection array
+// \return The allocated and populated compact indirection array
+uint32_t* compact_indirection_array( const size_t* indirection_array, size_t size ){
+  uint32_t* compact_array = (uint32_t*) counted_malloc( size * sizeof(uint32_t) );
+
+  #pragma omp parallel
+  scheduled_for( size, i, {
+    compact_array[i] = (uint32_t) indirection_array[i];
+  } );
+
+  return compact_array;
+}
+
+// \brief Partition elements into contiguous parts
+// Used across ranks for the distributed array, and along every dimension of a grid.
+// \param n_elts number of elements to partition
+// \param n_parts number of parts
+// \param part part to compute the portion of, in [0, n_parts)
+// \param distribution_type fair (equal parts, the first taking the remainder) or
+//   unfair (part p takes p+1 shares, the last taking the remainder)
+// \param portion set to the number of elements of the part
+// \param offset set to the index of the first element of the part
+void partition_elements( size_t n_elts, int n_parts, int part, distribution_type_t distribution_type, size_t* portion, size_t* offset ){
+  // Fair partitioning
+  if( distribution_type == distribute_fair ){
+    // Calculate size for local array
+    // Low portion is the floored average elements per part.
+    int low_portion = n_elts / n_parts;
+    // High portion is low portion + remainder of the elements.
+    // Easiest way to calculate this is to subtract the total amount of work
+    // owned by the *other* parts (n_parts-1 of them) , and subtract it from the total
+    int high_portion = n_elts - (low_portion * (n_parts - 1));
+
+    // Determine which portion this part owns
+    // First part takes larger portion
+    if( part == 0 ){
+      *portion = high_portion;
+    }
+    // Others take smaller portion)
+    else {
+      *portion = low_portion;
+    }
+
+    // Determin this part's offset, or global index corresponding to local index 0
+    // First part starts a 0
+    if( part == 0 ){
+      *offset = 0;
+    }
+    // Everyone else starts
+    else {
+      *offset = high_portion + ((part-1)*(low_portion));
+    }
+
+  }
+  // Unfair partitioning (for load imballance demonstration)
+  // Each partition takes part * (N / parts) amount of data
+  else if( distribution_type == distribute_unfair ){
+    int denomenator = (int) ( .5 * n_parts * (n_parts + 1) );
+    int portions[n_parts];
+    int offsets[n_parts];
+    int portion_sum = 0;
+    for( int sim_rank = 0; sim_rank < n_parts; ++sim_rank ){
+      portions[sim_rank] = (sim_rank+1) * (n_elts / denomenator);
+
+      if( sim_rank + 1 == n_parts ){
+        portions[sim_rank] += n_elts % denomenator;
+      }
+
+      portion_sum += portions[sim_rank];
+
+      if( sim_rank == 0 ){
+        offsets[sim_rank] = 0;
+      } else {
+        offsets[sim_rank] = offsets[sim_rank-1] + portions[sim_rank-1];
+      }
+    }
+
+    if( portion_sum != n_elts ){
+      fprintf( stderr, "Invalid portioning in partition_elements:\n" );
+
+      // Print rank's offset and portion
+      for( int sim_rank = 0; sim_rank < n_parts; ++sim_rank ){
+        fprintf( stderr, "\t%d:\t+%d\t%d\n", sim_rank, portions[sim_rank], offsets[sim_rank] );
+      }
+      fprintf( stderr, "\t------------------------\n\ttotal:\t\t\t%d\n", portion_sum );
+
+      exit(-1);
+    }
+
+    *portion = portions[part];
+    *offset  = offsets [part];
+
+  } else {
+    fprintf( stderr, "Unknown distribution type (%d)\n", distribution_type );
+    exit(-1);
+  }
+}
+
+// \brief Construct a distributed Cartesian grid
+// Ranks are arranged in a process grid by MPI_Dims_create, and every dimension
+// is partitioned across its ranks like the distributed array.
+// \param distribution_type type of distribution of elements along every dimension
+// \return allocated distributed array object, with the extents of global_program_context.grid_dims
+distributed_array allocate_distributed_grid( distribution_type_t distribution_type ){
+  const int n_dims = global_program_context.n_dims;
+  // Dimensions a 2D grid does not use come first
+  const int first_dim = 3 - n_dims;
+
+  // Process grid
+  int process_dims[3] = { 1, 1, 1 };
+  int periods[3] = { 0, 0, 0 };
+  int coords[3] = { 0, 0, 0 };
+  for( int dim = first_dim; dim < 3; ++dim ) process_dims[dim] = 0;
+  MPI_Dims_create( global_program_context.n_ranks, n_dims, process_dims + first_dim );
+
+  // Note: ranks are not reordered, so ranks in grid_comm are the same as in comm
+  MPI_Comm grid_comm;
+  MPI_Cart_create( global_program_context.comm, n_dims, process_dims + first_dim, periods, 0, &grid_comm );
+  MPI_Cart_coords( grid_comm, global_program_context.rank, n_dims, coords + first_dim );
+
+  distributed_array ret_obj = {
+    .active_buffer          = 0,
+    .element_type           = element_double,
+    .total_elts             = global_program_context.grid_dims[0] * global_program_context.grid_dims[1] * global_program_context.grid_dims[2],
+    .global_offset          = 0,
+    .n_dims                 = n_dims,
+    .grid_comm              = grid_comm,
+    .ghost_elts             = 0,
+    .n_indirection_arrays   = 0,
+    .indirection_array_next = 0,
+    .halo_buffers           = NULL,
+    .n_halo_requests        = 0,
+    .sum_request            = MPI_REQUEST_NULL,
+    .has_completed_sum      = false
+  };
+
+  // Local block, and face neighbors
+  size_t padded_elts = 1;
+  for( int dim = 0; dim < 3; ++dim ){
+    partition_elements( global_program_context.grid_dims[dim], process_dims[dim], coords[dim], distribution_type, &ret_obj.grid_local_dims[dim], &ret_obj.grid_offsets[dim] );
+    if( ret_obj.grid_local_dims[dim] == 0 ){
+      fprintf( stderr, "Error: rank %d owns no elements along dimension %d of the grid\n", global_program_context.rank, dim - first_dim );
+      exit(-1);
+    }
+    ret_obj.grid_padded_dims[dim] = ret_obj.grid_local_dims[dim] + ( ( dim >= first_dim ) ? 2 : 0 );
+    padded_elts *= ret_obj.grid_padded_dims[dim];
+
+    ret_obj.grid_neighbors[dim][0] = MPI_PROC_NULL;
+    ret_obj.grid_neighbors[dim][1] = MPI_PROC_NULL;
+    if( dim >= first_dim ){
+      MPI_Cart_shift( grid_comm, dim - first_dim, 1, &ret_obj.grid_neighbors[dim][0], &ret_obj.grid_neighbors[dim][1] );
+    }
+  }
+  ret_obj.local_elts = ret_obj.grid_local_dims[0] * ret_obj.grid_local_dims[1] * ret_obj.grid_local_dims[2];
+
+  ret_obj.local_array  = (double*) counted_malloc( padded_elts * sizeof(double) );
+  ret_obj.update_array = (double*) counted_malloc( padded_elts * sizeof(double) );
+
+  // Faces of a buffer, as subarrays of the padded block
+  int sizes[3];
+  for( int dim = 0; dim < 3; ++dim ) sizes[dim] = ret_obj.grid_padded_dims[dim];
+  for( int dim = 0; dim < 3; ++dim ){
+    for( int face = 0; face < grid_face_count; ++face ){
+      ret_obj.grid_faces[dim][face] = MPI_DATATYPE_NULL;
+    }
+    if( dim < first_dim ) continue;
+
+    const int face_starts[grid_face_count] = {
+      [grid_face_send_low]  = 1,
+      [grid_face_send_high] = ret_obj.grid_local_dims[dim],
+      [grid_face_recv_low]  = 0,
+      [grid_face_recv_high] = ret_obj.grid_local_dims[dim] + 1,
+    };
+    for( int face = 0; face < grid_face_count; ++face ){
+      int subsizes[3];
+      int starts[3];
+      for( int other_dim = 0; other_dim < 3; ++other_dim ){
+        subsizes[other_dim] = ret_obj.grid_local_dims[other_dim];
+        starts[other_dim] = ( other_dim >= first_dim ) ? 1 : 0;
+      }
+      subsizes[dim] = 1;
+      starts[dim] = face_starts[face];
+      MPI_Type_create_subarray( 3, sizes, subsizes, starts, MPI_ORDER_C, MPI_DOUBLE, &ret_obj.grid_faces[dim][face] );
+      MPI_Type_commit( &ret_obj.grid_faces[dim][face] );
+    }
+  }
+
+  // Create persistent halo exchange requests, one set per buffer
+  if( global_program_context.halo_exchange_type == halo_exchange_persistent ){
+    for( int buffer = 0; buffer < 2; ++buffer ){
+      double* buffer_array = (buffer == 0) ? ret_obj.local_array : ret_obj.update_array;
+      ret_obj.n_halo_requests = 0;
+      for( int dim = first_dim; dim < 3; ++dim ){
+        for( int side = 0; side < 2; ++side ){
+          const int neighbor = ret_obj.grid_neighbors[dim][side];
+          if( neighbor == MPI_PROC_NULL ) continue;
+          MPI_Recv_init( buffer_array, 1, ret_obj.grid_faces[dim][grid_face_recv_low + side], neighbor, 0, grid_comm, &ret_obj.halo_requests[buffer][ret_obj.n_halo_requests++] );
+          MPI_Send_init( buffer_array, 1, ret_obj.grid_faces[dim][grid_face_send_low + side], neighbor, 0, grid_comm, &ret_obj.halo_requests[buffer][ret_obj.n_halo_requests++] );
+        }
+      }
+    }
+  }
+
+  return ret_obj;
+}
+
+// \brief Construct distributed array
+// \param n_elts total number of elements across all processes for this distributed array.
+// \param distribution_type type of distribution of elements across process
+// \param element_type type of the elements (anything but double requires the compact layout)
+// \return allocated and populated distributed array object (a grid with -D, see allocate_distributed_grid)
+distributed_array allocate_distributed_array( size_t n_elts, distribution_type_t distribution_type, element_type_t element_type ){
+  // Grids are partitioned along every dimension
+  if( global_program_context.n_dims > 1 ){
+    return allocate_distributed_grid( distribution_type );
+  }
+
+  size_t portion, offset;
+  partition_elements( n_elts, global_program_context.n_ranks, global_program_context.rank, distribution_type, &portion, &offset );
+
+  // Ghost-cell layout pads each buffer on both sides
+  size_t ghost_elts = 0;
+  if( global_program_context.ghost_layout ){
+    ghost_elts = global_program_context.stencil_radius * global_program_context.temporal_block_depth;
+
+    // Halos are whole ghost regions, which neighbors must be able to send
+    if( portion < ghost_elts ){
+      fprintf( stderr, "Error: ghost-cell layout needs every rank to own at least %lu elements, but rank %d owns %lu\n", ghost_elts, global_program_context.rank, portion );
+      exit(-1);
+    }
+  }
+
+  // Note: only double is ever padded, the other element types require the compact layout
+  const size_t element_bytes = get_core_element_ops( element_type ).size;
+  double* array = (double*) counted_malloc( (portion + 2*ghost_elts)*element_bytes ) + ghost_elts;
+  double* update_array = (double*) counted_malloc( (portion + 2*ghost_elts)*element_bytes ) + ghost_elts;
+
+  // Create all the indirection arrays
+  // Note: when every local index fits in 32 bits, compact copies are kept
+  //       instead, halving the index traffic of the loops.
+  const double indirection_start_time = start_phase( phase_indirection );
+  size_t** indirection_arrays = NULL;
+  uint32_t** compact_indirection_arrays = NULL;
+  int n_indirection_arrays = 0;
+  if( is_iteration_order_indirect( global_program_context.iteration_order_type ) ){
+    n_indirection_arrays = 3 ;
+    const bool compact = portion <= (size_t) UINT32_MAX + 1;
+    if( compact ){
+      compact_indirection_arrays = (uint32_t**) counted_malloc( n_indirection_arrays*sizeof(uint32_t*) );
+    } else {
+      indirection_arrays = (size_t**) counted_malloc( n_indirection_arrays*sizeof(size_t*) );
+    }
+    for( size_t i = 0; i < n_indirection_arrays; ++i ){
+      size_t* indirection_array = create_local_indirection_array( portion, global_program_context.iteration_order_type, i );
+      if( compact ){
+        compact_indirection_arrays[i] = compact_indirection_array( indirection_array, portion );
+        free( indirection_array );
+      } else {
+        indirection_arrays[i] = indirection_array;
+      }
+    }
+  }
+
+  // Or the permutations computing them
+  feistel_permutation_t* feistel_permutations = NULL;
+  if( global_program_context.iteration_order_type == iteration_order_feistel_order ){
+    n_indirection_arrays = 3;
+    feistel_permutations = (feistel_permutation_t*) counted_malloc( n_indirection_arrays*sizeof(feistel_permutation_t) );
+    for( size_t i = 0; i < n_indirection_arrays; ++i ){
+      feistel_permutations[i] = create_local_feistel_permutation( portion, i );
+    }
+  }
+  end_phase( phase_indirection, indirection_start_time );
+
+  // Temporal tiling keeps the sums of every level of a block
+  double* tiled_level_sums = NULL;
+  if( global_program_context.temporal_tile_elts > 0 ){
+    tiled_level_sums = (double*) counted_malloc( global_program_context.temporal_block_depth * sizeof(double) );
+  }
+
+  // Create persistent halo exchange requests
+  // Note: buffers are heap allocated so that their addresses survive ret_obj
+  //       being copied out of this function.
+  double* halo_buffers = NULL;
+  MPI_Request halo_requests[2][MAX_HALO_REQUESTS];
+  int n_halo_requests = 0;
+  if( global_program_context.halo_exchange_type == halo_exchange_persistent && ghost_elts > 0 ){
+    // One set of requests per buffer, exchanging ghost_elts elements directly
+    // between the buffer's edges and its ghost cells.
+    for( int buffer = 0; buffer < 2; ++buffer ){
+      double* buffer_array = (buffer == 0) ? array : update_array;
+      n_halo_requests = 0;
+
+      // Low side
+      if( global_program_context.rank != 0 ){
+        MPI_Recv_init( buffer_array - ghost_elts, ghost_elts, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &halo_requests[buffer][n_halo_requests++] );
+        MPI_Send_init( buffer_array,              ghost_elts, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &halo_requests[buffer][n_halo_requests++] );
+      }
+
+      // High side
+      if( global_program_context.rank != global_program_context.n_ranks - 1 ){
+        MPI_Recv_init( buffer_array + portion,              ghost_elts, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &halo_requests[buffer][n_halo_requests++] );
+        MPI_Send_init( buffer_array + portion - ghost_elts, ghost_elts, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &halo_requests[buffer][n_halo_requests++] );
+      }
+    }
+  } else if( global_program_context.halo_exchange_type == halo_exchange_persistent ){
+    halo_buffers = (double*) counted_malloc( halo_buffer_count * sizeof(double) );
+
+    // Low side
+    if( global_program_context.rank != 0 ){
+      MPI_Recv_init( &halo_buffers[halo_recv_low], 1, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &halo_requests[0][n_halo_requests++] );
+      MPI_Send_init( &halo_buffers[halo_send_low], 1, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &halo_requests[0][n_halo_requests++] );
+    }
+
+    // High side
+    if( global_program_context.rank != global_program_context.n_ranks - 1 ){
+      MPI_Recv_init( &halo_buffers[halo_recv_high], 1, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &halo_requests[0][n_halo_requests++] );
+      MPI_Send_init( &halo_buffers[halo_send_high], 1, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &halo_requests[0][n_halo_requests++] );
+    }
+  }
+
+  // Construct and return distributed_array structure
+  distributed_array ret_obj = {
+    .local_array            = array,
+    .update_array           = update_array,
+    .element_type           = element_type,
+    .active_buffer          = 0,
+    .ghost_elts             = ghost_elts,
+    .temporal_step          = 0,
+    .halo_messages_sent     = 0,
+    .halo_messages_saved    = 0,
+    .redundant_updates      = 0,
+    .tiled_level_sums       = tiled_level_sums,
+    .tiled_level            = 0,
+    .local_elts             = portion,
+    .total_elts             = n_elts,
+    .global_offset          = offset,
+    .n_dims                 = 1,
+    .grid_comm              = MPI_COMM_NULL,
+    .n_indirection_arrays   = n_indirection_arrays,
+    .indirection_array_next = 0,
+    .indirection_arrays     = indirection_arrays,
+    .compact_indirection_arrays = compact_indirection_arrays,
+    .feistel_permutations   = feistel_permutations,
+    .halo_buffers           = halo_buffers,
+    .n_halo_requests        = n_halo_requests,
+    .sum_request            = MPI_REQUEST_NULL,
+    .has_completed_sum      = false
+  };
+  memcpy( ret_obj.halo_requests, halo_requests, sizeof(halo_requests) );
+
+  return ret_obj;
+}
+
+// \brief deallocated distributed array object
+// \param distributed_array distributed array object to be deallocated
+void free_distributed_array( distributed_array* distributed_array ){
+  free(distributed_array->local_array - distributed_array->ghost_elts);
+  free(distributed_array->update_array - distributed_array->ghost_elts);
+  // Note: only the ghost-cell layout and grids use the second set of requests
+  const int n_halo_request_sets = ( distributed_array->ghost_elts > 0 || distributed_array->n_dims > 1 ) ? 2 : 1;
+  for( int set = 0; set < n_halo_request_sets; ++set ){
+    for( int i = 0; i < distributed_array->n_halo_requests; ++i ){
+      MPI_Request_free( &distributed_array->halo_requests[set][i] );
+    }
+  }
+  if( distributed_array->n_dims > 1 ){
+    for( int dim = 0; dim < 3; ++dim ){
+      for( int face = 0; face < grid_face_count; ++face ){
+        if( distributed_array->grid_faces[dim][face] != MPI_DATATYPE_NULL ) MPI_Type_free( &distributed_array->grid_faces[dim][face] );
+      }
+    }
+    MPI_Comm_free( &distributed_array->grid_comm );
+  }
+  free(distributed_array->halo_buffers);
+  free(distributed_array->tiled_level_sums);
+  free( distributed_array->feistel_permutations );
+  if( distributed_array->indirection_arrays != NULL ){
+    for( size_t i = 0; i < distributed_array->n_indirection_arrays; ++i ){
+      free( distributed_array->indirection_arrays[i] );
+    }
+    free( distributed_array->indirection_arrays );
+  }
+  if( distributed_array->compact_indirection_arrays != NULL ){
+    for( size_t i = 0; i < distributed_array->n_indirection_arrays; ++i ){
+      free( distributed_array->compact_indirection_arrays[i] );
+    }
+    free( distributed_array->compact_indirection_arrays );
+  }
+}
+
+// \brief Swap a distributed array's local and update buffers
+// \param distributed_array distributed array object whose buffers to swap
+void swap_distributed_array_buffers( distributed_array* distributed_array ){
+  double* previous_local_array = distributed_array->local_array;
+  distributed_array->local_array = distributed_array->update_array;
+  distributed_array->update_array = previous_local_array;
+  distributed_array->active_buffer = 1 - distributed_array->active_buffer;
+}
+
+// \brief Read an element of a local array, whatever its element type
+// \param distributed_array distributed array object
+// \param i local index of the element
+// \return value of local_array[i]
+static inline double load_local_element( const distributed_array* distributed_array, size_t i ){
+  if( distributed_array->element_type == element_double ) return distributed_array->local_array[i];
+  return get_core_element_ops( distributed_array->element_type ).load( distributed_array->local_array, i );
+}
+
+// \brief Write an element of a local array, whatever its element type
+// \param distributed_array distributed array object
+// \param i local index of the element
+// \param value value to write, rounded to the element type
+static inline void store_local_element( distributed_array* distributed_array, size_t i, double value ){
+  if( distributed_array->element_type == element_double ){
+    distributed_array->local_array[i] = value;
+  } else {
+    get_core_element_ops( distributed_array->element_type ).store( distributed_array->local_array, i, value );
+  }
+}
+
+// Number of elements handed to a local kernel (init, stencil, sum) at a time,
+// in the default order.
+// Large enough to amortize the call, small enough for the schedule to balance.
+#define LOCAL_KERNEL_BLOCK_ELTS 4096
+
+// \brief Number of elements of a block of LOCAL_KERNEL_BLOCK_ELTS
+// \param block index of the block
+// \param n_elts number of elements of the range split into blocks
+// \return LOCAL_KERNEL_BLOCK_ELTS, but for the last block
+static inline size_t local_kernel_block_elts( const size_t block, const size_t n_elts ){
+  return min2( (size_t) LOCAL_KERNEL_BLOCK_ELTS, n_elts - block * LOCAL_KERNEL_BLOCK_ELTS );
+}
+
+// \brief Get the templated core kernels of a distributed array
+// Selected by the distributed array's iteration order and layout.
+// \param distributed_array distributed array object (not in the "feistel" order)
+// \return kernels
+static inline core_kernels_t get_distributed_array_core_kernels( const distributed_array* distributed_array ){
+  core_order_t order = core_order_direct;
+  if(      distributed_array->compact_indirection_arrays != NULL ) order = core_order_indirect32;
+  else if( distributed_array->indirection_arrays         != NULL ) order = core_order_indirect64;
+  const core_layout_t layout = global_program_context.ghost_layout ? core_layout_ghost : core_layout_compact;
+  return get_core_kernels( distributed_array->element_type, order, layout );
+}
+
+// \brief Get the templated core view of a distributed array
+// Views the current buffers, and the indirection array to use next.
+// \param distributed_array distributed array object (not in the "feistel" order)
+// \return view
+static inline core_view_t get_distributed_array_core_view( const distributed_array* distributed_array ){
+  const void* indices = NULL;
+  if(      distributed_array->compact_indirection_arrays != NULL ) indices = distributed_array->compact_indirection_arrays[distributed_array->indirection_array_next];
+  else if( distributed_array->indirection_arrays         != NULL ) indices = distributed_array->indirection_arrays[distributed_array->indirection_array_next];
+  return (core_view_t){
+    .local_array       = distributed_array->local_array,
+    .update_array      = distributed_array->update_array,
+    .local_elts        = distributed_array->local_elts,
+    .radius            = global_program_context.ghost_layout ? global_program_context.stencil_radius : 1,
+    .global_offset     = distributed_array->global_offset,
+    .total_elts        = distributed_array->total_elts,
+    .indices           = indices,
+    .prefetch_distance = global_prefetch_distance,
+  };
+}
+
+// \brief Stencilize a range of positions with a templated core kernel, in parallel
+// Positions are handed out in blocks.
+// \param kernels templated core kernels
+// \param view templated core view
+// \param begin first position
+// \param end one past the last position
+// \param valid_begin first local index (of the view) to update
+// \param valid_end one past the last local index (of the view) to update
+// \param accumulate_sum whether to sum the updated values
+// \return sum of the updated values if accumulate_sum, otherwise 0
+double stencilize_core_range( const core_kernels_t kernels, const core_view_t* view, size_t begin, size_t end, size_t valid_begin, size_t valid_end, const bool accumulate_sum ){
+  if( begin >= end ) return 0.0;
+
+  const size_t n_blocks = ( (end - begin) + LOCAL_KERNEL_BLOCK_ELTS - 1 ) / LOCAL_KERNEL_BLOCK_ELTS;
+  double local_sum = 0.0;
+
+  // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+  #pragma omp parallel reduction(+: local_sum)
+  scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, end - begin ), {
+    const size_t block_begin = begin + block * LOCAL_KERNEL_BLOCK_ELTS;
+    local_sum += kernels.stencil( view, block_begin, min2( block_begin + LOCAL_KERNEL_BLOCK_ELTS, end ), valid_begin, valid_end, accumulate_sum );
+  } );
+
+  return local_sum;
+}
+
+// \brief Initialize a contiguous range of a local array with arbitrary values
+// Note: branch-free, for the default order.
+// \param distributed_array distributed array object to populate with data
+// \param begin first local index to initialize
+// \param end one past the last local index to initialize
+static inline void init_local_range( distributed_array* distributed_array, size_t begin, size_t end ){
+  double* restrict array = distributed_array->local_array;
+  const double offset = distributed_array->global_offset;
+  const double total_elts = distributed_array->total_elts;
+  #pragma omp simd
+  for( size_t i = begin; i < end; ++i ){
+    double j = (i+1) + offset;
+    array[i] = sin( (j/total_elts) * 3.14159265358979323846 );
+  }
+}
+
+// \brief Number of rows of a grid's local block
+// A row is a line of owned elements along the fastest varying dimension.
+// \param distributed_array distributed array object (grid)
+// \return number of rows
+static inline size_t grid_n_rows( const distributed_array* distributed_array ){
+  return distributed_array->grid_local_dims[0] * distributed_array->grid_local_dims[1];
+}
+
+// \brief Padded index of the low ghost cell of a row of a grid's local block
+// The row's owned elements follow it, at offsets 1 through grid_local_dims[2].
+// \param distributed_array distributed array object (grid)
+// \param row row number, in [0, grid_n_rows)
+// \return index into the grid's buffers
+static inline size_t grid_row_origin( const distributed_array* distributed_array, size_t row ){
+  const size_t* local_dims = distributed_array->grid_local_dims;
+  const size_t* padded_dims = distributed_array->grid_padded_dims;
+  // Only a used slowest dimension has ghost cells
+  const size_t i0 = ( padded_dims[0] - local_dims[0] ) / 2 + row / local_dims[1];
+  const size_t i1 = 1 + row % local_dims[1];
+  return ( i0 * padded_dims[1] + i1 ) * padded_dims[2];
+}
+
+// \brief Whether no element of a row reads ghost cells across the slower dimensions
+// Such a row's elements only wait for halos at its two ends.
+// \param distributed_array distributed array object (grid)
+// \param row row number, in [0, grid_n_rows)
+// \return true if the row is interior
+static inline bool is_interior_grid_row( const distributed_array* distributed_array, size_t row ){
+  const size_t* local_dims = distributed_array->grid_local_dims;
+  const size_t i0 = row / local_dims[1];
+  const size_t i1 = row % local_dims[1];
+  const bool interior_0 = distributed_array->n_dims < 3 || ( i0 > 0 && i0 + 1 < local_dims[0] );
+  return interior_0 && i1 > 0 && i1 + 1 < local_dims[1];
+}
+
+// \brief Initialize the owned elements of a grid row
+// \param row_array first owned element of the row
+// \param row_elts number of owned elements in the row
+// \param row_offset global linear index of the first owned element
+// \param total_elts number of elements across all ranks
+static inline void init_grid_row( double* restrict row_array, size_t row_elts, double row_offset, double total_elts ){
+  #pragma omp simd
+  for( size_t i = 0; i < row_elts; ++i ){
+    double j = (i+1) + row_offset;
+    row_array[i] = sin( (j/total_elts) * 3.14159265358979323846 );
+  }
+}
+
+// \brief Initialize a grid with arbitrary values
+// Same values as the distributed array, from the global linear index.
+// \param distributed_array distributed array object (grid) to populate with data
+void init_grid_distributed_array( distributed_array* distributed_array ){
+  double* const array = distributed_array->local_array;
+  const size_t* local_dims = distributed_array->grid_local_dims;
+  const size_t* offsets = distributed_array->grid_offsets;
+  const size_t* grid_dims = global_program_context.grid_dims;
+  const double total_elts = distributed_array->total_elts;
+
+  // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+  #pragma omp parallel
+  scheduled_elts_for( grid_n_rows( distributed_array ), row, local_dims[2], {
+    const size_t g0 = offsets[0] + row / local_dims[1];
+    const size_t g1 = offsets[1] + row % local_dims[1];
+    const double row_offset = ( g0 * grid_dims[1] + g1 ) * grid_dims[2] + offsets[2];
+    init_grid_row( array + grid_row_origin( distributed_array, row ) + 1, local_dims[2], row_offset, total_elts );
+  } );
+}
+
+// \brief Initialize distributed array with arbitrary values.
+// \param distributed_array distributed array object to populate with data
+void init_distributed_array( distributed_array* distributed_array ){
+  if( distributed_array->n_dims > 1 ){
+    init_grid_distributed_array( distributed_array );
+    return;
+  }
+
+  // The templated core has a kernel for every order, handed out in blocks of positions
+  if( global_program_context.stencil_kernel_type == stencil_kernel_templated ){
+    const core_kernels_t kernels = get_distributed_array_core_kernels( distributed_array );
+    const core_view_t view = get_distributed_array_core_view( distributed_array );
+    const size_t n_elts = distributed_array->local_elts;
+    const size_t n_blocks = ( n_elts + LOCAL_KERNEL_BLOCK_ELTS - 1 ) / LOCAL_KERNEL_BLOCK_ELTS;
+
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    #pragma omp parallel
+    scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+      const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+      kernels.init( &view, begin, min2( begin + LOCAL_KERNEL_BLOCK_ELTS, n_elts ) );
+    } );
+    advance_iteration_order( distributed_array );
+    return;
+  }
+
+  // Default order is handed out in blocks, to a branch-free kernel
+  if( has_default_iteration_order( distributed_array ) ){
+    const size_t n_elts = distributed_array->local_elts;
+    const size_t n_blocks = ( n_elts + LOCAL_KERNEL_BLOCK_ELTS - 1 ) / LOCAL_KERNEL_BLOCK_ELTS;
+
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    #pragma omp parallel
+    scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+      const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+      init_local_range( distributed_array, begin, min2( begin + LOCAL_KERNEL_BLOCK_ELTS, n_elts ) );
+    } );
+    return;
+  }
+
+  // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+  #pragma omp parallel
+  distributed_array_local_for(
+    distributed_array,
+    i,
+    NULL,
+    distributed_array->local_array,
+    {
+      // Use global offset to create value for this local index
+      double j = (i+1) + distributed_array->global_offset;
+      distributed_array->local_array[i] = sin( (j/distributed_array->total_elts) * 3.14159265358979323846 );
+    }
+  );
+}
+
+// \brief Complete an in-flight deferred sum reduction, if any
+// The result is kept in completed_sum until collected with collect_deferred_sum.
+// \param distributed_array distributed array object whose deferred sum to complete
+void progress_deferred_sum( distributed_array* distributed_array ){
+  if( distributed_array->sum_request == MPI_REQUEST_NULL ) return;
+
+  double start_time = start_phase( phase_reduce );
+  MPI_Wait( &distributed_array->sum_request, MPI_STATUS_IGNORE );
+  end_phase( phase_reduce, start_time );
+
+  distributed_array->completed_sum = distributed_array->sum_request_global;
+  distributed_array->has_completed_sum = true;
+}
+
+// \brief Collect the result of a deferred sum reduction
+// Picks up the result completed (normally) during the stencil following the
+// reduction's start. The in-flight reduction is only waited on if requested.
+// \param distributed_array distributed array object whose deferred sum to collect
+// \param sum where to write the collected sum
+// \param wait whether to complete the in-flight reduction if there is no completed result
+// \return true if a sum was collected, false otherwise
+bool collect_deferred_sum( distributed_array* distributed_array, double* sum, const bool wait ){
+  if( ! distributed_array->has_completed_sum && wait ){
+    progress_deferred_sum( distributed_array );
+  }
+
+  if( ! distributed_array->has_completed_sum ) return false;
+
+  *sum = distributed_array->completed_sum;
+  distributed_array->has_completed_sum = false;
+  return true;
+}
+
+
+// Signature of a stencil interior kernel.
+// Computes update_array[i] for i in [begin, end), reading array[begin-1] through
+// array[end], so callers must keep begin >= 1 and end <= n_elts - 1.
+// Summing kernels return the sum of the values written, others return 0.
+typedef double (*stencil_interior_kernel_t)( const double* restrict array, double* restrict update_array, size_t begin, size_t end );
+
+// \brief Branch-free scalar stencil interior
+// Note: accumulate_sum is always a constant at the call sites below, so each
+//       wrapper is compiled without the accumulation it does not need.
+static inline __attribute__((always_inline))
+double stencil_interior_scalar_impl( const double* restrict array, double* restrict update_array, size_t begin, size_t end, const bool accumulate_sum ){
+  double sum = 0.0;
+  for( size_t i = begin; i < end; ++i ){
+    double max_val = max3( array[i-1], array[i], array[i+1] );
+    double min_val = min3( array[i-1], array[i], array[i+1] );
+    update_array[i] = max_val / (1 + fabs(min_val) );
+    if( accumulate_sum ) sum += update_array[i];
+  }
+  return sum;
+}
+
+double stencil_interior_scalar( const double* restrict array, double* restrict update_array, size_t begin, size_t end ){
+  return stencil_interior_scalar_impl( array, update_array, begin, end, false );
+}
+
+double stencil_interior_sum_scalar( const double* restrict array, double* restrict update_array, size_t begin, size_t end ){
+  return stencil_interior_scalar_impl( array, update_array, begin, end, true );
+}
+
+#if MINIAPP_X86_SIMD
+// \brief AVX2 stencil interior
+// Note: max_pd/min_pd return the second operand on ties, which is the same as
+//       the max/min macros, so results are bit-identical to the scalar kernel.
+__attribute__((target("avx2"))) static inline __attribute__((always_inline))
+double stencil_interior_avx2_impl( const double* restrict array, double* restrict update_array, size_t begin, size_t end, const bool accumulate_sum ){
+  const __m256d one = _mm256_set1_pd( 1.0 );
+  const __m256d sign_bit = _mm256_set1_pd( -0.0 );
+  __m256d sums = _mm256_setzero_pd();
+  size_t i = begin;
+  for( ; i + 4 <= end; i += 4 ){
+    __m256d left   = _mm256_loadu_pd( &array[i-1] );
+    __m256d center = _mm256_loadu_pd( &array[i]   );
+    __m256d right  = _mm256_loadu_pd( &array[i+1] );
+    __m256d max_val = _mm256_max_pd( left, _mm256_max_pd( center, right ) );
+    __m256d min_val = _mm256_min_pd( left, _mm256_min_pd( center, right ) );
+    __m256d denominator = _mm256_add_pd( one, _mm256_andnot_pd( sign_bit, min_val ) );
+    __m256d update = _mm256_div_pd( max_val, denominator );
+    _mm256_storeu_pd( &update_array[i], update );
+    if( accumulate_sum ) sums = _mm256_add_pd( sums, update );
+  }
+  double sum = 0.0;
+  if( accumulate_sum ){
+    double lanes[4];
+    _mm256_storeu_pd( lanes, sums );
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  }
+  // Remainder
+  return sum + stencil_interior_scalar_impl( array, update_array, i, end, accumulate_sum );
+}
+
+__attribute__((target("avx2")))
+double stencil_interior_avx2( const double* restrict array, double* restrict update_array, size_t begin, size_t end ){
+  return stencil_interior_avx2_impl( array, update_array, begin, end, false );
+}
+
+__attribute__((target("avx2")))
+double stencil_interior_sum_avx2( const double* restrict array, double* restrict update_array, size_t begin, size_t end ){
+  return stencil_interior_avx2_impl( array, update_array, begin, end, true );
+}
+
+// \brief AVX-512 stencil interior
+__attribute__((target("avx512f"))) static inline __attribute__((always_inline))
+double stencil_interior_avx512_impl( const double* restrict array, double* restrict update_array, size_t begin, size_t end, const bool accumulate_sum ){
+  const __m512d one = _mm512_set1_pd( 1.0 );
+  __m512d sums = _mm512_setzero_pd();
+  size_t i = begin;
+  for( ; i + 8 <= end; i += 8 ){
+    __m512d left   = _mm512_loadu_pd( &array[i-1] );
+    __m512d center = _mm512_loadu_pd( &array[i]   );
+    __m512d right  = _mm512_loadu_pd( &array[i+1] );
+    __m512d max_val = _mm512_max_pd( left, _mm512_max_pd( center, right ) );
+    __m512d min_val = _mm512_min_pd( left, _mm512_min_pd( center, right ) );
+    __m512d denominator = _mm512_add_pd( one, _mm512_abs_pd( min_val ) );
+    __m512d update = _mm512_div_pd( max_val, denominator );
+    _mm512_storeu_pd( &update_array[i], update );
+    if( accumulate_sum ) sums = _mm512_add_pd( sums, update );
+  }
+  double sum = accumulate_sum ? _mm512_reduce_add_pd( sums ) : 0.0;
+  // Remainder
+  return sum + stencil_interior_scalar_impl( array, update_array, i, end, accumulate_sum );
+}
+
+__attribute__((target("avx512f")))
+double stencil_interior_avx512( const double* restrict array, double* restrict update_array, size_t begin, size_t end ){
+  return stencil_interior_avx512_impl( array, update_array, begin, end, false );
+}
+
+__attribute__((target("avx512f")))
+double stencil_interior_sum_avx512( const double* restrict array, double* restrict update_array, size_t begin, size_t end ){
+  return stencil_interior_avx512_impl( array, update_array, begin, end, true );
+}
+#endif
+
+// \brief Whether the stencil is computed by the operator kernels
+// The -x kernels only implement the "maxmin" operator, without the intensity dial.
+// \return true with -K other than "maxmin", or -I
+static inline bool uses_stencil_operator_kernels( ){
+  return global_program_context.stencil_operator_type != stencil_operator_maxmin || global_program_context.stencil_intensity > 0;
+}
+
+// \brief Last step of a stencil operator, after the whole window is accumulated
+// \param stencil_operator_type operator
+// \param value accumulated value (the max for "maxmin")
+// \param min_value min of the window ("maxmin" only)
+// \param n_points points in the window
+// \return updated value
+static inline __attribute__((always_inline))
+double finish_stencil_operator( const stencil_operator_type_t stencil_operator_type, double value, double min_value, size_t n_points ){
+  switch( stencil_operator_type ){
+    case stencil_operator_maxmin:         return value / (1 + fabs(min_value) );
+    case stencil_operator_jacobi:         return value / n_points;
+    case stencil_operator_transcendental: return value / n_points;
+    default:                              return value;
+  }
+}
+
+// \brief Apply a stencil operator to one window
+// Note: for the few single windows (the ends of local arrays), the kernels
+//       below do the same operations in the same order, strip by strip.
+// \param stencil_operator_type operator to apply
+// \param center element at the center of the window, radius valid elements on each side
+// \param radius stencil radius
+// \return updated value of the center element, before the intensity dial
+double stencil_operator_element( const stencil_operator_type_t stencil_operator_type, const double* restrict center, size_t radius ){
+  const double* window = center - radius;
+  const size_t n_points = 2 * radius + 1;
+  double value = 0.0;
+  double min_value = 0.0;
+  for( size_t j = 0; j < n_points; ++j ){
+    switch( stencil_operator_type ){
+      case stencil_operator_maxmin:
+        value     = ( j == 0 ) ? window[j] : max2( value, window[j] );
+        min_value = ( j == 0 ) ? window[j] : min2( min_value, window[j] );
+        break;
+      case stencil_operator_jacobi:
+        value = ( j == 0 ) ? window[j] : value + window[j];
+        break;
+      case stencil_operator_weighted:
+        value = ( j == 0 ) ? global_stencil_operator_weights[j] * window[j] : value + global_stencil_operator_weights[j] * window[j];
+        break;
+      case stencil_operator_transcendental:
+        value = ( j == 0 ) ? sin( window[j] ) * exp( -fabs( window[j] ) ) : value + sin( window[j] ) * exp( -fabs( window[j] ) );
+        break;
+      default: break;
+    }
+  }
+  return finish_stencil_operator( stencil_operator_type, value, min_value, n_points );
+}
+
+// \brief Apply the intensity dial (-I) to an updated value
+// \param update updated value
+// \return the same value, after stencil_intensity multiply-adds
+static inline __attribute__((always_inline))
+double apply_stencil_intensity( double update ){
+  const double scale = global_stencil_intensity_scale;
+  const double shift = global_stencil_intensity_shift;
+  for( int k = 0; k < global_program_context.stencil_intensity; ++k ){
+    update = update * scale + shift;
+  }
+  return update;
+}
+
+// \brief Apply the stencil to the window of an end element
+// The element missing from the window at an end of the whole array is the
+// end element itself, which leaves the max/min of the truncated window unchanged.
+// \param low element before
+// \param center element to update
+// \param high element after
+// \return updated value of center
+double stencil_end_element( double low, double center, double high ){
+  if( ! uses_stencil_operator_kernels() ){
+    return max3( low, center, high ) / (1 + fabs( min3( low, center, high ) ) );
+  }
+  const double window[3] = { low, center, high };
+  return apply_stencil_intensity( stencil_operator_element( global_program_context.stencil_operator_type, window + 1, 1 ) );
+}
+
+// Elements an operator kernel computes at a time
+// Their partial results are kept in two arrays of this many elements, small
+// enough to stay in L1 while the window is swept through.
+#define STENCIL_OPERATOR_STRIP_ELTS 512
+
+// \brief Operator kernel over a range, see stencil_operator_element
+// Computes update_array[i] for i in [begin, end), reading array[begin-radius]
+// through array[end-1+radius]. Each strip of elements is swept one window point
+// at a time, so every inner loop is a plain SIMD loop over the strip (a loop over
+// the window per element does not vectorize), with the same operations in the
+// same order as stencil_operator_element.
+// Note: the intensity dial is applied in passes of 4 dependent multiply-adds per
+//       element, independent across the strip, so it is bound by the FMA units
+//       rather than by their latency or by L1.
+static inline __attribute__((always_inline))
+double stencil_operator_range_impl( const stencil_operator_type_t stencil_operator_type, const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius, const bool accumulate_sum ){
+  const size_t n_points = 2 * radius + 1;
+  const double* restrict weights = global_stencil_operator_weights;
+  const int intensity = global_program_context.stencil_intensity;
+  const double scale = global_stencil_intensity_scale;
+  const double shift = global_stencil_intensity_shift;
+  double sum = 0.0;
+
+  double values[STENCIL_OPERATOR_STRIP_ELTS];
+  double min_values[STENCIL_OPERATOR_STRIP_ELTS];
+  for( size_t strip = begin; strip < end; strip += STENCIL_OPERATOR_STRIP_ELTS ){
+    const size_t n = min2( end - strip, STENCIL_OPERATOR_STRIP_ELTS );
+    const double* restrict window = array + strip - radius;
+
+    // First point of the window
+    #pragma omp simd
+    for( size_t i = 0; i < n; ++i ){
+      switch( stencil_operator_type ){
+        case stencil_operator_maxmin:         values[i] = window[i]; min_values[i] = window[i]; break;
+        case stencil_operator_jacobi:         values[i] = window[i]; break;
+        case stencil_operator_weighted:       values[i] = weights[0] * window[i]; break;
+        case stencil_operator_transcendental: values[i] = sin( window[i] ) * exp( -fabs( window[i] ) ); break;
+        default: break;
+      }
+    }
+
+    // Other points
+    for( size_t j = 1; j < n_points; ++j ){
+      #pragma omp simd
+      for( size_t i = 0; i < n; ++i ){
+        const double point = window[i + j];
+        switch( stencil_operator_type ){
+          case stencil_operator_maxmin:         values[i] = max2( values[i], point ); min_values[i] = min2( min_values[i], point ); break;
+          case stencil_operator_jacobi:         values[i] += point; break;
+          case stencil_operator_weighted:       values[i] += weights[j] * point; break;
+          case stencil_operator_transcendental: values[i] += sin( point ) * exp( -fabs( point ) ); break;
+          default: break;
+        }
+      }
+    }
+
+    // Without the intensity dial, the update is finished as it is stored
+    if( intensity == 0 ){
+      #pragma omp simd reduction(+: sum)
+      for( size_t i = 0; i < n; ++i ){
+        update_array[strip + i] = finish_stencil_operator( stencil_operator_type, values[i], min_values[i], n_points );
+        if( accumulate_sum ) sum += update_array[strip + i];
+      }
+      continue;
+    }
+
+    #pragma omp simd
+    for( size_t i = 0; i < n; ++i ){
+      values[i] = finish_stencil_operator( stencil_operator_type, values[i], min_values[i], n_points );
+    }
+
+    // Intensity dial
+    int k = 0;
+    for( ; k + 4 <= intensity; k += 4 ){
+      #pragma omp simd
+      for( size_t i = 0; i < n; ++i ){
+        double update = values[i];
+        update = update * scale + shift;
+        update = update * scale + shift;
+        update = update * scale + shift;
+        update = update * scale + shift;
+        values[i] = update;
+      }
+    }
+    for( ; k < intensity; ++k ){
+      #pragma omp simd
+      for( size_t i = 0; i < n; ++i ){
+        values[i] = values[i] * scale + shift;
+      }
+    }
+
+    #pragma omp simd reduction(+: sum)
+    for( size_t i = 0; i < n; ++i ){
+      update_array[strip + i] = values[i];
+      if( accumulate_sum ) sum += values[i];
+    }
+  }
+  return sum;
+}
+
+// \brief Operator kernel over a range, for the program's operator (-K)
+double stencil_operator_range( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius, const bool accumulate_sum ){
+  #define stencil_operator_case( type ) \
+    case type: return accumulate_sum ? stencil_operator_range_impl( type, array, update_array, begin, end, radius, true ) \
+                                     : stencil_operator_range_impl( type, array, update_array, begin, end, radius, false );
+  switch( global_program_context.stencil_operator_type ){
+    stencil_operator_case( stencil_operator_maxmin )
+    stencil_operator_case( stencil_operator_jacobi )
+    stencil_operator_case( stencil_operator_weighted )
+    stencil_operator_case( stencil_operator_transcendental )
+    default: {
+      fprintf( stderr, "Internal Error: no kernel for stencil operator %d\n", global_program_context.stencil_operator_type );
+      exit(-1);
+    }
+  }
+  #undef stencil_operator_case
+}
+
+// \brief Interior operator kernel (-K, -I)
+double stencil_operator_interior( const double* restrict array, double* restrict update_array, size_t begin, size_t end ){
+  return stencil_operator_range( array, update_array, begin, end, 1, false );
+}
+
+// \brief Interior operator kernel (-K, -I), returning the sum of the values it writes
+double stencil_operator_interior_sum( const double* restrict array, double* restrict update_array, size_t begin, size_t end ){
+  return stencil_operator_range( array, update_array, begin, end, 1, true );
+}
+
+// \brief Get interior kernel for a (resolved) stencil kernel type
+// \param stencil_kernel_type stencil kernel, must not be auto or generic
+// \param accumulate_sum whether the kernel should return the sum of the values it writes
+// \return interior kernel function (the operator kernel with -K or -I, whatever the type)
+stencil_interior_kernel_t get_stencil_interior_kernel( const stencil_kernel_type_t stencil_kernel_type, const bool accumulate_sum ){
+  if( uses_stencil_operator_kernels() ){
+    return accumulate_sum ? stencil_operator_interior_sum : stencil_operator_interior;
+  }
+  switch( stencil_kernel_type ){
+#if MINIAPP_X86_SIMD
+    case stencil_kernel_avx2:   return accumulate_sum ? stencil_interior_sum_avx2   : stencil_interior_avx2;
+    case stencil_kernel_avx512: return accumulate_sum ? stencil_interior_sum_avx512 : stencil_interior_avx512;
+#endif
+    case stencil_kernel_scalar: return accumulate_sum ? stencil_interior_sum_scalar : stencil_interior_scalar;
+    default: {
+      fprintf( stderr, "Internal Error: no interior kernel for stencil kernel \"%s\"\n", stencil_kernel_name( stencil_kernel_type ) );
+      exit(-1);
+    }
+  }
+}
+
+// \brief "Stencilize" a local array in parallel, optionally summing the result
+// The stencil function is: A'[i] = max( A[i-1], A[i], A[i+1] ) / (1 + abs( min( A[i-1], A[i], A[i+1]  ) ) )
+// Operation happens 'in-place' in that the distribued array object is modified,
+// but because there can be a random order of modifications, updates are written
+// into the array object's second (update) buffer. When all updates are written,
+// the local and update buffers are swapped, so no memory is allocated or freed.
+// Bondaries are handled by only using the valid cells in the neighborhood in
+// the stencil fuction.
+// In the default order (and unless the generic kernel is requested), the two
+// boundary elements are peeled off and the interior is computed in blocks by
+// the branch-free kernel selected with -x.
+// \param distributed_array distributed array object whose local array will have stencil operation applied to it.
+// \param accumulate_sum whether to sum the updated values in the same pass
+// \return sum of the updated local array if accumulate_sum, otherwise 0
+double stencilize_local_array( distributed_array* distributed_array, const bool accumulate_sum ){
+  // Array where updates are written to.
+  // At the end, this will become the new local array.
+  double* const update_array = distributed_array->update_array;
+
+  // Use these constants for less typing.
+  const double* const array = distributed_array->local_array;
+  const size_t n_elts = distributed_array->local_elts;
+
+  double local_sum = 0.0;
+
+  if( global_program_context.stencil_kernel_type == stencil_kernel_templated ){
+    const core_kernels_t kernels = get_distributed_array_core_kernels( distributed_array );
+    const core_view_t view = get_distributed_array_core_view( distributed_array );
+    local_sum = stencilize_core_range( kernels, &view, 0, n_elts, 0, n_elts, accumulate_sum );
+    advance_iteration_order( distributed_array );
+  } else if( has_default_iteration_order( distributed_array )
+   && global_program_context.stencil_kernel_type != stencil_kernel_generic
+   && n_elts >= 2
+  ){
+    const stencil_interior_kernel_t kernel = get_stencil_interior_kernel( global_program_context.stencil_kernel_type, accumulate_sum );
+
+    // Peeled boundaries
+    update_array[0]        = stencil_end_element( array[0], array[0], array[1] );
+    update_array[n_elts-1] = stencil_end_element( array[n_elts-2], array[n_elts-1], array[n_elts-1] );
+    if( accumulate_sum ) local_sum = update_array[0] + update_array[n_elts-1];
+
+    // Interior is [1, n_elts-1), handed out in blocks
+    const size_t n_blocks = ( (n_elts - 2) + LOCAL_KERNEL_BLOCK_ELTS - 1 ) / LOCAL_KERNEL_BLOCK_ELTS;
+
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    #pragma omp parallel reduction(+: local_sum)
+    scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts - 2 ), {
+      const size_t begin = 1 + block * LOCAL_KERNEL_BLOCK_ELTS;
+      const size_t end   = min2( begin + LOCAL_KERNEL_BLOCK_ELTS, n_elts - 1 );
+      local_sum += kernel( array, update_array, begin, end );
+    } );
+  } else {
+    #define generic_stencil_body( i ) {                         \
+      double max_val;                                           \
+      double min_val;                                           \
+      if( i == 0 ){                                             \
+        max_val = max2( array[0], array[1] );                   \
+        min_val = min2( array[0], array[1] );                   \
+      } else if ( i == n_elts - 1 ){                            \
+        max_val = max2( array[n_elts-2], array[n_elts-1] );     \
+        min_val = min2( array[n_elts-2], array[n_elts-1] );     \
+      } else {                                                  \
+        max_val = max3( array[i-1], array[i], array[i+1] );     \
+        min_val = min3( array[i-1], array[i], array[i+1] );     \
+      }                                                         \
+      update_array[i] =  max_val / (1 + fabs(min_val) );        \
+    }
+
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    if( accumulate_sum ){
+      #pragma omp parallel reduction(+: local_sum)
+      distributed_array_local_for(
+        distributed_array,
+        i,
+        array,
+        update_array,
+        {
+          generic_stencil_body( i );
+          local_sum += update_array[i];
+        }
+      );
+    } else {
+      #pragma omp parallel
+      distributed_array_local_for(
+        distributed_array,
+        i,
+        array,
+        update_array,
+        {
+          generic_stencil_body( i );
+        }
+      );
+    }
+
+    #undef generic_stencil_body
+  }
 
-    .N                     = N,
-    .iterations            = iterations,
-    .synchronize_at_end_of_distributed_array_operations = synchronize_at_end_of_distributed_array_operations,
-    .verbosity             = verbosity,
-    .distribution_type     = distribution_type,
-    .iteration_order_type  = iteration_order_type,
+  // Swap local array with update array
+  swap_distributed_array_buffers( distributed_array );
 
-    .rank                  = rank,
-    .n_ranks               = n_ranks,
-    .primary_rank          = 0, // rank 0 is always the primary rank
-    .comm                  = comm,
-    .omp_num_threads       = omp_num_threads,
+  return local_sum;
+}
 
-    .omp_loop_schedule     = omp_schedule,
-    .omp_chunk_size        = omp_chunk_size,
+// \brief "Stencilize" a local array in parallel
+// See stencilize_local_array.
+// \param distributed_array distributed array object whose local array will have stencil operation applied to it.
+void in_place_stencilize_local_array( distributed_array* distributed_array ){
+  stencilize_local_array( distributed_array, false );
+}
 
-    .seed                  = rank_seed
-  };
+// Signature of a radius-r stencil kernel for the ghost-cell layout.
+// Computes update_array[i] for i in [begin, end), reading array[begin-radius]
+// through array[end-1+radius], which may be ghost cells.
+// Summing kernels return the sum of the values written, others return 0.
+typedef double (*stencil_radius_kernel_t)( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius );
+
+// \brief Radius-r stencil of a single element
+// \param array array (with at least radius valid cells on each side of i)
+// \param i index of element to compute
+// \param radius stencil radius
+// \return max( A[i-r..i+r] ) / (1 + abs( min( A[i-r..i+r] ) ) )
+static inline __attribute__((always_inline))
+double stencil_radius_element( const double* restrict array, size_t i, size_t radius ){
+  const double* window = array + i - radius;
+  double max_val = window[0];
+  double min_val = window[0];
+  for( size_t j = 1; j <= 2*radius; ++j ){
+    max_val = max2( max_val, window[j] );
+    min_val = min2( min_val, window[j] );
+  }
+  return max_val / (1 + fabs(min_val) );
+}
 
-  // I really want all members of program_context_t to be const,
-  // So we memcpy it into place to force the overwrite.
-  memcpy( &global_program_context, &ret_obj, sizeof(program_context_t) );
+// \brief Scalar radius-r stencil
+// Note: radius 1 is dispatched to the hand-written interior kernels, which
+//       are valid on the whole local array in the ghost-cell layout.
+static inline __attribute__((always_inline))
+double stencil_radius_scalar_impl( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius, const bool accumulate_sum ){
+  if( radius == 1 ) return stencil_interior_scalar_impl( array, update_array, begin, end, accumulate_sum );
 
-  int compare = memcmp( &ret_obj, &global_program_context, sizeof(program_context_t) );
-  if( compare != 0 ){
-    fprintf( stderr, "Internal Error: mock program context (@%p) and global_program_context (@%p) are unequal (%d)\n", &ret_obj, &global_program_context, compare );
-    exit(-1);
+  double sum = 0.0;
+  for( size_t i = begin; i < end; ++i ){
+    update_array[i] = stencil_radius_element( array, i, radius );
+    if( accumulate_sum ) sum += update_array[i];
   }
+  return sum;
+}
 
-  // Should be able to set the schedule here, and never worry about how to set
-  // set the for loop clause
-  omp_set_schedule( global_program_context.omp_loop_schedule, global_program_context.omp_chunk_size );
+double stencil_radius_scalar( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius ){
+  return stencil_radius_scalar_impl( array, update_array, begin, end, radius, false );
+}
 
-  omp_set_num_threads( global_program_context.omp_num_threads );
+double stencil_radius_sum_scalar( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius ){
+  return stencil_radius_scalar_impl( array, update_array, begin, end, radius, true );
+}
 
-  return ret_obj;
+#if MINIAPP_X86_SIMD
+// \brief AVX2 radius-r stencil
+__attribute__((target("avx2"))) static inline __attribute__((always_inline))
+double stencil_radius_avx2_impl( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius, const bool accumulate_sum ){
+  if( radius == 1 ) return stencil_interior_avx2_impl( array, update_array, begin, end, accumulate_sum );
+
+  const __m256d one = _mm256_set1_pd( 1.0 );
+  const __m256d sign_bit = _mm256_set1_pd( -0.0 );
+  __m256d sums = _mm256_setzero_pd();
+  size_t i = begin;
+  for( ; i + 4 <= end; i += 4 ){
+    const double* window = array + i - radius;
+    __m256d max_val = _mm256_loadu_pd( window );
+    __m256d min_val = max_val;
+    for( size_t j = 1; j <= 2*radius; ++j ){
+      __m256d value = _mm256_loadu_pd( window + j );
+      max_val = _mm256_max_pd( max_val, value );
+      min_val = _mm256_min_pd( min_val, value );
+    }
+    __m256d denominator = _mm256_add_pd( one, _mm256_andnot_pd( sign_bit, min_val ) );
+    __m256d update = _mm256_div_pd( max_val, denominator );
+    _mm256_storeu_pd( &update_array[i], update );
+    if( accumulate_sum ) sums = _mm256_add_pd( sums, update );
+  }
+  double sum = 0.0;
+  if( accumulate_sum ){
+    double lanes[4];
+    _mm256_storeu_pd( lanes, sums );
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  }
+  // Remainder
+  return sum + stencil_radius_scalar_impl( array, update_array, i, end, radius, accumulate_sum );
 }
 
+__attribute__((target("avx2")))
+double stencil_radius_avx2( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius ){
+  return stencil_radius_avx2_impl( array, update_array, begin, end, radius, false );
+}
 
-// \brief Create proper indirection array of size for distributed_array_t given the indirection order type
-// \param size number indices of indirection array
-// \param iteration_order_type order type of indirection array
-// \returns The allocated and populated indirection array
-size_t* create_local_indirection_array( size_t size, iteration_order_type_t iteration_order_type  ){
-  size_t* indirection_array = NULL;
+__attribute__((target("avx2")))
+double stencil_radius_sum_avx2( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius ){
+  return stencil_radius_avx2_impl( array, update_array, begin, end, radius, true );
+}
 
-  // One of the indirection orderings
-  if( is_iteration_order_indirect( iteration_order_type ) ) {
-    indirection_array = (size_t*) malloc( size * sizeof(size_t) );
-    // Fill indirection array with
-    // Note: this does not *need* to be parallel but hey whatever.
-    #pragma omp parallel for
-    for( size_t i = 0; i < size; ++i ){
-      indirection_array[i] = i;
+// \brief AVX-512 radius-r stencil
+__attribute__((target("avx512f"))) static inline __attribute__((always_inline))
+double stencil_radius_avx512_impl( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius, const bool accumulate_sum ){
+  if( radius == 1 ) return stencil_interior_avx512_impl( array, update_array, begin, end, accumulate_sum );
+
+  const __m512d one = _mm512_set1_pd( 1.0 );
+  __m512d sums = _mm512_setzero_pd();
+  size_t i = begin;
+  for( ; i + 8 <= end; i += 8 ){
+    const double* window = array + i - radius;
+    __m512d max_val = _mm512_loadu_pd( window );
+    __m512d min_val = max_val;
+    for( size_t j = 1; j <= 2*radius; ++j ){
+      __m512d value = _mm512_loadu_pd( window + j );
+      max_val = _mm512_max_pd( max_val, value );
+      min_val = _mm512_min_pd( min_val, value );
     }
+    __m512d denominator = _mm512_add_pd( one, _mm512_abs_pd( min_val ) );
+    __m512d update = _mm512_div_pd( max_val, denominator );
+    _mm512_storeu_pd( &update_array[i], update );
+    if( accumulate_sum ) sums = _mm512_add_pd( sums, update );
+  }
+  double sum = accumulate_sum ? _mm512_reduce_add_pd( sums ) : 0.0;
+  // Remainder
+  return sum + stencil_radius_scalar_impl( array, update_array, i, end, radius, accumulate_sum );
+}
 
-    // Random indirection order
-    // Note: Going through the motions of the randomization, but only do the
-    // value swap if order is random_order. This includes forcing *both* memory
-    // reads and writes to locations that where the source and destination are
-    // easily analysed to be the same, which requires the volatiles in order to
-    // force the compiler to always read and write the values, even if it's
-    // writing to the same place it read the value from originally and would
-    // have no effect.
-    // Todo: is swap passes enough? Too much?
-    const int swap_passes = 2;
-    for( int swap_pass = 0; swap_pass < swap_passes; swap_pass += 1 ){
-      for( int from = 0; from < size; ++from){
-        // choose another index that is different
-        int to;
-        while( (to = rand() % size) == from ){ }
-
-        // swap indexes
-        // Note: again, going through the motions. Need volatile pointer casting
-        // to force the reads *and* writes
-        size_t from_value =  ((size_t volatile*)indirection_array)[from];
-        size_t to_value   =  ((size_t volatile*)indirection_array)[to];
-
-        if( global_program_context.iteration_order_type == iteration_order_random_order ){
-          ((size_t volatile*)indirection_array)[from] = to_value;
-          ((size_t volatile*)indirection_array)[to]   = from_value;
-        } else {
-          ((size_t volatile*)indirection_array)[from] = from_value;
-          ((size_t volatile*)indirection_array)[to]   = to_value;
-        }
-      } // for from ...
-    } // for swap_pass
-  } // if global_program_context.iteration_order_type ...
-
-  return indirection_array;
+__attribute__((target("avx512f")))
+double stencil_radius_avx512( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius ){
+  return stencil_radius_avx512_impl( array, update_array, begin, end, radius, false );
 }
 
-// \brief Construct distributed array
-// \param n_elts total number of elements across all processes for this distributed array.
-// \param distribution_type type of distribution of elements across process
-// \return allocated and populated distributed array object
-distributed_array allocate_distributed_array( size_t n_elts, distribution_type_t distribution_type ){
-  size_t portion, offset;
+__attribute__((target("avx512f")))
+double stencil_radius_sum_avx512( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius ){
+  return stencil_radius_avx512_impl( array, update_array, begin, end, radius, true );
+}
+#endif
 
-  // Fair partitioning
-  if( distribution_type == distribute_fair ){
-    // Calculate size for local array
-    // Low portion is the floored average elements per rank.
-    int low_portion = n_elts / global_program_context.n_ranks;
-    // High portion is low portion + remainder of the elements.
-    // Easiest way to calculate this is to subtract the total amount of work
-    // owned by the *other* ranks (n_ranks-1 of them) , and subtract it from the total
-    int high_portion = n_elts - (low_portion * (global_program_context.n_ranks - 1));
+// \brief Radius-r operator kernel (-K, -I)
+double stencil_operator_radius( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius ){
+  return stencil_operator_range( array, update_array, begin, end, radius, false );
+}
 
-    // Determine which portion this rank owns
-    // Primary takes larger portion
-    if( global_program_context.rank == global_program_context.primary_rank ){
-      portion = high_portion;
-    }
-    // Others take smaller portion)
-    else {
-      portion = low_portion;
-    }
+// \brief Radius-r operator kernel (-K, -I), returning the sum of the values it writes
+double stencil_operator_radius_sum( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t radius ){
+  return stencil_operator_range( array, update_array, begin, end, radius, true );
+}
 
-    // Determin this ranks offset, or global index corresponding to local index 0
-    // Primary starts a 0
-    if( global_program_context.rank == global_program_context.primary_rank ){
-      offset = 0;
-    }
-    // Everyone else starts
-    else {
-      offset = high_portion + ((global_program_context.rank-1)*(low_portion));
+// \brief Get radius-r kernel for a (resolved) stencil kernel type
+// \param stencil_kernel_type stencil kernel, must not be auto or generic
+// \param accumulate_sum whether the kernel should return the sum of the values it writes
+// \return radius-r kernel function (the operator kernel with -K or -I, whatever the type)
+stencil_radius_kernel_t get_stencil_radius_kernel( const stencil_kernel_type_t stencil_kernel_type, const bool accumulate_sum ){
+  if( uses_stencil_operator_kernels() ){
+    return accumulate_sum ? stencil_operator_radius_sum : stencil_operator_radius;
+  }
+  switch( stencil_kernel_type ){
+#if MINIAPP_X86_SIMD
+    case stencil_kernel_avx2:   return accumulate_sum ? stencil_radius_sum_avx2   : stencil_radius_avx2;
+    case stencil_kernel_avx512: return accumulate_sum ? stencil_radius_sum_avx512 : stencil_radius_avx512;
+#endif
+    case stencil_kernel_scalar: return accumulate_sum ? stencil_radius_sum_scalar : stencil_radius_scalar;
+    default: {
+      fprintf( stderr, "Internal Error: no radius kernel for stencil kernel \"%s\"\n", stencil_kernel_name( stencil_kernel_type ) );
+      exit(-1);
     }
+  }
+}
 
+// \brief Stencilize a contiguous range of a ghost-cell layout local array in parallel
+// The range may extend into the ghost cells, as long as radius cells beyond it
+// are valid.
+// \param distributed_array distributed array object (ghost-cell layout)
+// \param begin first local index to compute (may be negative)
+// \param end one past the last local index to compute
+// \param accumulate_sum whether to sum the updated values
+// \return sum of the updated values if accumulate_sum, otherwise 0
+double stencilize_ghost_local_range( distributed_array* distributed_array, ptrdiff_t begin, ptrdiff_t end, const bool accumulate_sum ){
+  if( begin >= end ) return 0.0;
+
+  // Kernels index from the start of the padding, so all indices are positive
+  const ptrdiff_t ghost_elts = distributed_array->ghost_elts;
+
+  // The templated core views the padded buffers in the default order
+  if( global_program_context.stencil_kernel_type == stencil_kernel_templated ){
+    const core_kernels_t kernels = get_core_kernels( distributed_array->element_type, core_order_direct, core_layout_ghost );
+    core_view_t view = get_distributed_array_core_view( distributed_array );
+    view.local_array  = distributed_array->local_array - ghost_elts;
+    view.update_array = distributed_array->update_array - ghost_elts;
+    view.local_elts   = distributed_array->local_elts + 2 * ghost_elts;
+    return stencilize_core_range( kernels, &view, begin + ghost_elts, end + ghost_elts, begin + ghost_elts, end + ghost_elts, accumulate_sum );
   }
-  // Unfair partitioning (for load imballance demonstration)
-  // Each partition takes rank * (N / ranks) amount of data
-  else if( distribution_type == distribute_unfair ){
-    int denomenator = (int) ( .5 * global_program_context.n_ranks * (global_program_context.n_ranks + 1) );
-    int portions[global_program_context.n_ranks];
-    int offsets[global_program_context.n_ranks];
-    int portion_sum = 0;
-    for( int sim_rank = 0; sim_rank < global_program_context.n_ranks; ++sim_rank ){
-      portions[sim_rank] = (sim_rank+1) * (n_elts / denomenator);
 
-      if( sim_rank + 1 == global_program_context.n_ranks ){
-        portions[sim_rank] += n_elts % denomenator;
-      }
+  const double* const array = distributed_array->local_array - ghost_elts;
+  double* const update_array = distributed_array->update_array - ghost_elts;
+  const size_t radius = global_program_context.stencil_radius;
 
-      portion_sum += portions[sim_rank];
+  // Note: the generic kernel has no radius kernel, it uses the scalar one here
+  stencil_kernel_type_t stencil_kernel_type = global_program_context.stencil_kernel_type;
+  if( stencil_kernel_type == stencil_kernel_generic ) stencil_kernel_type = stencil_kernel_scalar;
+  const stencil_radius_kernel_t kernel = get_stencil_radius_kernel( stencil_kernel_type, accumulate_sum );
 
-      if( sim_rank == 0 ){
-        offsets[sim_rank] = 0;
-      } else {
-        offsets[sim_rank] = offsets[sim_rank-1] + portions[sim_rank-1];
-      }
-    }
+  const size_t n_blocks = ( (end - begin) + LOCAL_KERNEL_BLOCK_ELTS - 1 ) / LOCAL_KERNEL_BLOCK_ELTS;
 
-    if( portion_sum != n_elts ){
-      fprintf( stderr, "Invalid portioning in init_distributed_array:\n" );
+  double local_sum = 0.0;
 
-      // Print rank's offset and portion
-      for( int sim_rank = 0; sim_rank < global_program_context.n_ranks; ++sim_rank ){
-        fprintf( stderr, "\t%d:\t+%d\t%d\n", sim_rank, portions[sim_rank], offsets[sim_rank] );
-      }
-      fprintf( stderr, "\t------------------------\n\ttotal:\t\t\t%d\n", portion_sum );
+  // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+  #pragma omp parallel reduction(+: local_sum)
+  scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, end - begin ), {
+    const ptrdiff_t block_begin = begin + (ptrdiff_t)( block * LOCAL_KERNEL_BLOCK_ELTS );
+    const ptrdiff_t block_end   = min2( block_begin + LOCAL_KERNEL_BLOCK_ELTS, end );
+    local_sum += kernel( array, update_array, block_begin + ghost_elts, block_end + ghost_elts, radius );
+  } );
 
+  return local_sum;
+}
+
+// \brief Start the halo exchange of a ghost-cell layout distributed array
+// Exchanges ghost_elts elements directly between the edges of the local array
+// and the neighbors' ghost cells.
+// \param distributed_array distributed array object (ghost-cell layout)
+// \param requests storage for up to 4 requests, used unless requests are persistent
+// \param active_requests set to the requests to complete
+// \return number of requests in active_requests
+int start_ghost_halo_exchange( distributed_array* distributed_array, MPI_Request* requests, MPI_Request** active_requests ){
+  double* const array = distributed_array->local_array;
+  const size_t n_elts = distributed_array->local_elts;
+  const size_t ghost_elts = distributed_array->ghost_elts;
+  int n_requests = 0;
+
+  if( global_program_context.halo_exchange_type == halo_exchange_persistent ){
+    *active_requests = distributed_array->halo_requests[distributed_array->active_buffer];
+    n_requests = distributed_array->n_halo_requests;
+
+    int start_err = MPI_Startall( n_requests, *active_requests );
+    if( start_err != MPI_SUCCESS ){
+      fprintf( stderr, "Error during MPI_Startall call: %d", start_err );
       exit(-1);
     }
+  } else {
+    *active_requests = requests;
 
-    portion = portions[global_program_context.rank];
-    offset  = offsets [global_program_context.rank];
+    // Low side
+    if( global_program_context.rank != 0 ){
+      int recv_err = MPI_Irecv( array - ghost_elts, ghost_elts, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &requests[n_requests++] );
+      if( recv_err != MPI_SUCCESS ){
+        fprintf( stderr, "Error during ghost low MPI_Irecv call: %d", recv_err );
+        exit(-1);
+      }
 
-  } else {
-    fprintf( stderr, "Unknown distribution type (%d)\n", distribution_type );
-    exit(-1);
-  }
+      int send_err = MPI_Isend( array,              ghost_elts, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &requests[n_requests++] );
+      if( send_err != MPI_SUCCESS ){
+        fprintf( stderr, "Error during ghost low MPI_Isend call: %d", send_err );
+        exit(-1);
+      }
+    }
 
-  double* array = (double*) malloc( portion*sizeof(double) );
+    // High side
+    if( global_program_context.rank != global_program_context.n_ranks - 1 ){
+      int recv_err = MPI_Irecv( array + n_elts,              ghost_elts, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &requests[n_requests++] );
+      if( recv_err != MPI_SUCCESS ){
+        fprintf( stderr, "Error during ghost high MPI_Irecv call: %d", recv_err );
+        exit(-1);
+      }
 
-  // Create all the indirection arrays
-  size_t** indirection_arrays = NULL;
-  int n_indirection_arrays = 0;
-  if( is_iteration_order_indirect( global_program_context.iteration_order_type ) ){
-    n_indirection_arrays = 3 ;
-    indirection_arrays = (size_t**) malloc( n_indirection_arrays*sizeof(size_t*) );
-    for( size_t i = 0; i < n_indirection_arrays; ++i ){
-      indirection_arrays[i] = create_local_indirection_array( portion, global_program_context.iteration_order_type );
+      int send_err = MPI_Isend( array + n_elts - ghost_elts, ghost_elts, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &requests[n_requests++] );
+      if( send_err != MPI_SUCCESS ){
+        fprintf( stderr, "Error during ghost high MPI_Isend call: %d", send_err );
+        exit(-1);
+      }
     }
   }
 
-  // Construct and return distributed_array structure
-  distributed_array ret_obj = {
-    .local_array            = array,
-    .local_elts             = portion,
-    .total_elts             = n_elts,
-    .global_offset          = offset,
-    .n_indirection_arrays   = n_indirection_arrays,
-    .indirection_array_next = 0,
-    .indirection_arrays     = indirection_arrays
-  };
+  return n_requests;
+}
 
-  return ret_obj;
+// \brief Fill the ghost cells at the ends of the whole array with copies of the end element
+// This leaves the max/min of the truncated neighborhood unchanged.
+// \param distributed_array distributed array object (ghost-cell layout)
+// \param array buffer of distributed_array (local index 0) to fill
+// \param n_ghosts number of ghost cells to fill on each end
+void replicate_ghost_ends( distributed_array* distributed_array, double* array, size_t n_ghosts ){
+  const size_t n_elts = distributed_array->local_elts;
+  if( global_program_context.rank == 0 ){
+    for( size_t j = 1; j <= n_ghosts; ++j ) array[-(ptrdiff_t)j] = array[0];
+  }
+  if( global_program_context.rank == global_program_context.n_ranks - 1 ){
+    for( size_t j = 0; j < n_ghosts; ++j ) array[n_elts + j] = array[n_elts - 1];
+  }
 }
 
-// \brief deallocated distributed array object
-// \param distributed_array distributed array object to be deallocated
-void free_distributed_array( distributed_array* distributed_array ){
-  free(distributed_array->local_array);
-  if( distributed_array->n_indirection_arrays > 0 ){
-    for( size_t i = 0; i < distributed_array->n_indirection_arrays; ++i ){
-      free( distributed_array->indirection_arrays[i] );
-    }
-    free( distributed_array->indirection_arrays );
+// \brief Floating point operations per stencil update
+// Of the program's operator (-K) over 2r+1 points:
+//   "maxmin"         : 2r max and 2r min comparisons, an abs, an add and a divide.
+//   "jacobi"         : 2r adds and a divide.
+//   "weighted"       : 2r+1 multiplies and 2r adds.
+//   "transcendental" : a sin, an exp (one flop each), an abs and a multiply per
+//                      point, 2r adds and a divide.
+// plus a multiply and an add per repetition of the intensity dial (-I).
+// \param radius stencil radius
+// \return flops per updated element
+size_t stencil_flops_per_update( size_t radius ){
+  size_t flops = 0;
+  switch( global_program_context.stencil_operator_type ){
+    case stencil_operator_maxmin:         flops = 4*radius + 3; break;
+    case stencil_operator_jacobi:         flops = 2*radius + 1; break;
+    case stencil_operator_weighted:       flops = 4*radius + 1; break;
+    case stencil_operator_transcendental: flops = 4*(2*radius + 1) + 2*radius + 1; break;
+    default: break;
   }
+  return flops + 2 * global_program_context.stencil_intensity;
 }
 
-// \brief Initialize distributed array with arbitrary values.
-// \param distributed_array distributed array object to populate with data
-void init_distributed_array( distributed_array* distributed_array ){
-    // Note: Schedule and chunk-size were set at program init.
-    //       There should be no reason to need any scheduling causes here.
-    #pragma omp parallel for
+// \brief Distributed-Parallel "Stencilize" whole distributed array in the ghost-cell layout
+// The stencil function is: A'[i] = max( A[i-r..i+r] ) / (1 + abs( min( A[i-r..i+r] ) ) )
+// Halos are exchanged directly between the edges of the local array and the
+// neighbors' ghost cells. The interior (which does not read ghost cells) is
+// computed while the exchange is in flight, then the 2r boundary elements are
+// computed by the same kernel once it completes. Ghost cells at the ends of the
+// whole array are filled with copies of the end element, which leaves the
+// max/min of the truncated neighborhood unchanged.
+// With temporal blocking depth k, halos of depth r*k are only exchanged every
+// k calls. Each call also computes the ghost cells that the remaining calls
+// before the next exchange still read, so every owned element is computed from
+// exactly the same values as with k = 1.
+// Note: does not synchronize at the end; callers handle
+//       synchronize_at_end_of_distributed_array_operations.
+// \param distributed_array distributed array object (ghost-cell layout) to perform stencil operation on
+// \param accumulate_sum whether to sum the updated local array in the same pass
+// \return sum of the updated local array if accumulate_sum, otherwise 0
+double stencilize_ghost_distributed_array( distributed_array* distributed_array, const bool accumulate_sum ){
+  double* const array = distributed_array->local_array;
+  double* const update_array = distributed_array->update_array;
+  const size_t n_elts = distributed_array->local_elts;
+  const size_t ghost_elts = distributed_array->ghost_elts;
+  const size_t radius = global_program_context.stencil_radius;
+  const size_t depth = global_program_context.temporal_block_depth;
+
+  const bool has_low_neighbor  = global_program_context.rank != 0;
+  const bool has_high_neighbor = global_program_context.rank != global_program_context.n_ranks - 1;
+  const size_t n_neighbors = has_low_neighbor + has_high_neighbor;
+
+  // Only exchange at the start of a temporal block
+  const bool exchange = distributed_array->temporal_step == 0;
+
+  // Ghost cells still read by the remaining steps of this temporal block
+  const size_t extension = radius * ( depth - 1 - distributed_array->temporal_step );
+  const size_t low_extension  = has_low_neighbor  ? extension : 0;
+  const size_t high_extension = has_high_neighbor ? extension : 0;
+
+  // First, start the halo exchange into this buffer's ghost cells
+  MPI_Request requests[4];
+  MPI_Request* active_requests = requests;
+  int n_requests = 0;
+
+  if( exchange ){
+    n_requests = start_ghost_halo_exchange( distributed_array, requests, &active_requests );
+    distributed_array->halo_messages_sent += n_neighbors;
+  } else {
+    distributed_array->halo_messages_saved += n_neighbors;
+  }
+
+  // Ends of the whole array replicate their end element into the ghost cells
+  // Note: done every step, as these ghost cells are not computed
+  double start_time = start_phase( phase_stencil );
+  replicate_ghost_ends( distributed_array, array, ghost_elts );
+
+  // Second, compute the interior while the exchange is in flight
+  // The interior is [radius, n_elts - radius) when exchanging, otherwise all
+  // halos needed are already present and it is the whole local array.
+  const size_t interior_begin = exchange ? min2( radius, n_elts ) : 0;
+  const size_t interior_end   = exchange ? max2( interior_begin, ( n_elts > radius ) ? n_elts - radius : 0 ) : n_elts;
+  double local_sum = 0.0;
+
+  if( global_program_context.stencil_kernel_type == stencil_kernel_templated ){
+    // Every position is visited, only the interior is updated
+    const core_kernels_t kernels = get_distributed_array_core_kernels( distributed_array );
+    const core_view_t view = get_distributed_array_core_view( distributed_array );
+    local_sum = stencilize_core_range( kernels, &view, 0, n_elts, interior_begin, interior_end, accumulate_sum );
+    advance_iteration_order( distributed_array );
+  } else if( has_default_iteration_order( distributed_array ) && global_program_context.stencil_kernel_type != stencil_kernel_generic ){
+    local_sum = stencilize_ghost_local_range( distributed_array, interior_begin, interior_end, accumulate_sum );
+  } else {
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    #pragma omp parallel reduction(+: local_sum)
     distributed_array_local_for(
       distributed_array,
       i,
+      array,
+      update_array,
       {
-        // Use global offset to create value for this local index
-        double j = (i+1) + distributed_array->global_offset;
-        distributed_array->local_array[i] = sin( (j/distributed_array->total_elts) * 3.14159265358979323846 );
+        // Boundary elements wait for the halos
+        if( i < interior_begin || i >= interior_end ) continue;
+
+        update_array[i] = stencil_radius_element( array, i, radius );
+        if( accumulate_sum ) local_sum += update_array[i];
       }
     );
+  }
+  end_phase( phase_stencil, start_time );
+
+  // Complete the previous iteration's deferred sum, if any, now that the local
+  // stencil has had time to overlap with it.
+  progress_deferred_sum( distributed_array );
+
+  // Third, complete the exchange
+  // Note: sends are completed too, as the next stencil writes into this buffer
+  start_time = start_phase( phase_halo_wait );
+  MPI_Waitall( n_requests, active_requests, MPI_STATUSES_IGNORE );
+  end_phase( phase_halo_wait, start_time );
+
+  // Fourth, compute the boundary elements with the same kernel
+  start_time = start_phase( phase_end_fixup );
+  local_sum += stencilize_ghost_local_range( distributed_array, 0, interior_begin, accumulate_sum );
+  local_sum += stencilize_ghost_local_range( distributed_array, interior_end, n_elts, accumulate_sum );
+
+  // Fifth, redundantly compute the ghost cells the rest of the block needs
+  // Note: these are not part of this rank's sum
+  stencilize_ghost_local_range( distributed_array, -(ptrdiff_t)low_extension, 0, false );
+  stencilize_ghost_local_range( distributed_array, n_elts, n_elts + high_extension, false );
+  distributed_array->redundant_updates += low_extension + high_extension;
+  end_phase( phase_end_fixup, start_time );
+
+  distributed_array->temporal_step = ( distributed_array->temporal_step + 1 ) % depth;
+
+  // Swap local array with update array
+  swap_distributed_array_buffers( distributed_array );
+
+  return local_sum;
 }
 
-// \brief "Stencilize" a local array in parallel
-// The stencil function is: A'[i] = max( A[i-1], A[i], A[i+1] ) / (1 + abs( min( A[i-1], A[i], A[i+1]  ) ) )
-// Operation happens 'in-place' in that the distribued array object is modified,
-// but because there can be a random order of modifications, this still requires
-// the allocation of a new array to write updates into. When all updates are
-// written, the array object's previous local array is freed, and the update
-// array is assigned as the array object's local array. This is still legal for
-// future deallocation of the distributed array object. Bondaries are handled
-// by only using the valid cells in the neighborhood in the stencil fuction.
-// \param distributed_array distributed array object whose local array will have stencil operation applied to it.
-void in_place_stencilize_local_array( distributed_array* distributed_array ){
-  // Array where updates are written to.
-  // At the end, this will become the new local array.
-  double* update_array = (double*) malloc( distributed_array->local_elts * sizeof(double) );
+// \brief Branch-free grid stencil over a range of a row
+// Reads the face neighbors along every dimension, a 2D grid passes
+// stride_0 = 0 so its slowest "neighbors" are the element itself.
+// \param array buffer read (padded)
+// \param update_array buffer written (padded)
+// \param begin first padded index to update
+// \param end one past the last padded index to update
+// \param stride_1 distance between neighbors along the middle dimension
+// \param stride_0 distance between neighbors along the slowest dimension
+// \return sum of the updated elements if accumulate_sum, otherwise 0
+static inline __attribute__((always_inline))
+double stencil_grid_row_impl( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t stride_1, size_t stride_0, const bool accumulate_sum ){
+  double sum = 0.0;
+  #pragma omp simd reduction(+: sum)
+  for( size_t i = begin; i < end; ++i ){
+    const double max_2 = max2( array[i-1], max2( array[i], array[i+1] ) );
+    const double min_2 = min2( array[i-1], min2( array[i], array[i+1] ) );
+    const double max_1 = max2( array[i-stride_1], array[i+stride_1] );
+    const double min_1 = min2( array[i-stride_1], array[i+stride_1] );
+    const double max_0 = max2( array[i-stride_0], array[i+stride_0] );
+    const double min_0 = min2( array[i-stride_0], array[i+stride_0] );
+    const double max_val = max2( max_2, max2( max_1, max_0 ) );
+    const double min_val = min2( min_2, min2( min_1, min_0 ) );
+    update_array[i] = max_val / ( 1 + fabs( min_val ) );
+    if( accumulate_sum ) sum += update_array[i];
+  }
+  return sum;
+}
 
-  // Use these constants for less typing.
-  const double* const array = distributed_array->local_array;
-  const size_t n_elts = distributed_array->local_elts;
+// \brief Grid stencil over a range of a row, see stencil_grid_row_impl
+double stencil_grid_row( const double* restrict array, double* restrict update_array, size_t begin, size_t end, size_t stride_1, size_t stride_0, const bool accumulate_sum ){
+  if( accumulate_sum ) return stencil_grid_row_impl( array, update_array, begin, end, stride_1, stride_0, true );
+  return stencil_grid_row_impl( array, update_array, begin, end, stride_1, stride_0, false );
+}
 
-  // Note: Schedule and chunk-size were set at program init.
-  //       There should be no reason to need any scheduling causes here.
-  #pragma omp parallel for
-  distributed_array_local_for(
-    distributed_array,
-    i,
-    {
-      double max_val;
-      double min_val;
-      if( i == 0 ){
-        max_val = max2( array[0], array[1] );
-        min_val = min2( array[0], array[1] );
-      } else if ( i == n_elts - 1 ){
-        max_val = max2( array[n_elts-2], array[n_elts-1] );
-        min_val = min2( array[n_elts-2], array[n_elts-1] );
-      } else {
-        max_val = max3( array[i-1], array[i], array[i+1] );
-        min_val = min3( array[i-1], array[i], array[i+1] );
+// \brief Start the halo exchange of a grid's faces
+// Every face is sent straight from, and received straight into, the buffer
+// with a subarray datatype, so no packing is done here.
+// \param distributed_array distributed array object (grid)
+// \param requests storage for up to MAX_HALO_REQUESTS requests, used unless requests are persistent
+// \param active_requests set to the requests to complete
+// \return number of requests in active_requests
+int start_grid_halo_exchange( distributed_array* distributed_array, MPI_Request* requests, MPI_Request** active_requests ){
+  double* const array = distributed_array->local_array;
+  int n_requests = 0;
+
+  if( global_program_context.halo_exchange_type == halo_exchange_persistent ){
+    *active_requests = distributed_array->halo_requests[distributed_array->active_buffer];
+    n_requests = distributed_array->n_halo_requests;
+
+    int start_err = MPI_Startall( n_requests, *active_requests );
+    if( start_err != MPI_SUCCESS ){
+      fprintf( stderr, "Error during MPI_Startall call: %d", start_err );
+      exit(-1);
+    }
+  } else {
+    *active_requests = requests;
+
+    for( int dim = 3 - distributed_array->n_dims; dim < 3; ++dim ){
+      for( int side = 0; side < 2; ++side ){
+        const int neighbor = distributed_array->grid_neighbors[dim][side];
+        if( neighbor == MPI_PROC_NULL ) continue;
+
+        int recv_err = MPI_Irecv( array, 1, distributed_array->grid_faces[dim][grid_face_recv_low + side], neighbor, 0, distributed_array->grid_comm, &requests[n_requests++] );
+        if( recv_err != MPI_SUCCESS ){
+          fprintf( stderr, "Error during grid face MPI_Irecv call: %d", recv_err );
+          exit(-1);
+        }
+
+        int send_err = MPI_Isend( array, 1, distributed_array->grid_faces[dim][grid_face_send_low + side], neighbor, 0, distributed_array->grid_comm, &requests[n_requests++] );
+        if( send_err != MPI_SUCCESS ){
+          fprintf( stderr, "Error during grid face MPI_Isend call: %d", send_err );
+          exit(-1);
+        }
       }
-      update_array[i] =  max_val / (1 + abs(min_val) );
     }
-  );
+  }
 
-  // Swap out old array with update array, free old array
-  double* previous_local_array = distributed_array->local_array;
-  distributed_array->local_array = update_array;
-  free( previous_local_array );
+  return n_requests;
+}
+
+// \brief Fill the ghost cells on a face of the whole grid with copies of the owned face
+// This leaves the max/min of the truncated neighborhood unchanged.
+// \param distributed_array distributed array object (grid)
+// \param array buffer of distributed_array to fill
+// \param dim dimension the face is normal to
+// \param side 0 for the low face, 1 for the high face
+void replicate_grid_face( distributed_array* distributed_array, double* array, int dim, int side ){
+  const size_t* local_dims = distributed_array->grid_local_dims;
+  const size_t* padded_dims = distributed_array->grid_padded_dims;
+  const size_t strides[3] = { padded_dims[1] * padded_dims[2], padded_dims[2], 1 };
+
+  // Owned elements along every dimension, but only the owned face along dim
+  size_t begin[3], end[3];
+  for( int d = 0; d < 3; ++d ){
+    begin[d] = ( padded_dims[d] - local_dims[d] ) / 2;
+    end[d] = begin[d] + local_dims[d];
+  }
+  if( side == 0 ){
+    end[dim] = begin[dim] + 1;
+  } else {
+    begin[dim] = end[dim] - 1;
+  }
+  const ptrdiff_t ghost_offset = ( side == 0 ) ? -(ptrdiff_t) strides[dim] : (ptrdiff_t) strides[dim];
+
+  for( size_t i0 = begin[0]; i0 < end[0]; ++i0 ){
+    for( size_t i1 = begin[1]; i1 < end[1]; ++i1 ){
+      for( size_t i2 = begin[2]; i2 < end[2]; ++i2 ){
+        const size_t i = i0 * strides[0] + i1 * strides[1] + i2;
+        array[i + ghost_offset] = array[i];
+      }
+    }
+  }
+}
+
+// \brief Distributed-Parallel "Stencilize" a whole grid
+// The stencil function is the distributed array's, over the face neighbors
+// along every dimension (a 5-point stencil in 2D, 7-point in 3D):
+//   A'[i] = max( A[i], A[i +/- e_d] ) / (1 + abs( min( A[i], A[i +/- e_d] ) ) )
+// Halos are exchanged with every face neighbor of the process grid at once.
+// Rows not reading ghost cells across the slower dimensions are computed
+// (except their two ends) while the exchange is in flight, then the ends and
+// the remaining rows once it completes. Ghost cells on the faces of the whole
+// grid are filled with copies of the owned face.
+// Note: does not synchronize at the end; callers handle
+//       synchronize_at_end_of_distributed_array_operations.
+// \param distributed_array distributed array object (grid) to perform stencil operation on
+// \param accumulate_sum whether to sum the updated local block in the same pass
+// \return sum of the updated local block if accumulate_sum, otherwise 0
+double stencilize_grid_distributed_array( distributed_array* distributed_array, const bool accumulate_sum ){
+  double* const array = distributed_array->local_array;
+  double* const update_array = distributed_array->update_array;
+  const size_t row_elts = distributed_array->grid_local_dims[2];
+  const size_t stride_1 = distributed_array->grid_padded_dims[2];
+  const size_t stride_0 = ( distributed_array->n_dims == 3 ) ? distributed_array->grid_padded_dims[1] * stride_1 : 0;
+  const size_t n_rows = grid_n_rows( distributed_array );
+
+  // First, start the halo exchange into this buffer's ghost cells
+  MPI_Request requests[MAX_HALO_REQUESTS];
+  MPI_Request* active_requests = requests;
+  const int n_requests = start_grid_halo_exchange( distributed_array, requests, &active_requests );
+
+  // Faces of the whole grid replicate their owned face into the ghost cells
+  double start_time = start_phase( phase_stencil );
+  for( int dim = 3 - distributed_array->n_dims; dim < 3; ++dim ){
+    for( int side = 0; side < 2; ++side ){
+      if( distributed_array->grid_neighbors[dim][side] == MPI_PROC_NULL ) replicate_grid_face( distributed_array, array, dim, side );
+    }
+  }
+
+  // Second, compute the interior rows, but their ends, while the exchange is in flight
+  double local_sum = 0.0;
+
+  // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+  #pragma omp parallel reduction(+: local_sum)
+  scheduled_elts_for( n_rows, row, ( is_interior_grid_row( distributed_array, row ) && row_elts > 2 ) ? row_elts - 2 : 0, {
+    if( is_interior_grid_row( distributed_array, row ) && row_elts > 2 ){
+      const size_t origin = grid_row_origin( distributed_array, row );
+      local_sum += stencil_grid_row( array, update_array, origin + 2, origin + row_elts, stride_1, stride_0, accumulate_sum );
+    }
+  } );
+  end_phase( phase_stencil, start_time );
+
+  // Complete the previous iteration's deferred sum, if any, now that the local
+  // stencil has had time to overlap with it.
+  progress_deferred_sum( distributed_array );
+
+  // Third, complete the exchange
+  // Note: sends are completed too, as the next stencil writes into this buffer
+  start_time = start_phase( phase_halo_wait );
+  MPI_Waitall( n_requests, active_requests, MPI_STATUSES_IGNORE );
+  end_phase( phase_halo_wait, start_time );
+
+  // Fourth, compute the ends of the interior rows, and the other rows
+  start_time = start_phase( phase_end_fixup );
+  #pragma omp parallel reduction(+: local_sum)
+  scheduled_elts_for( n_rows, row, ( is_interior_grid_row( distributed_array, row ) && row_elts > 2 ) ? 2 : row_elts, {
+    const size_t origin = grid_row_origin( distributed_array, row );
+    if( is_interior_grid_row( distributed_array, row ) && row_elts > 2 ){
+      local_sum += stencil_grid_row( array, update_array, origin + 1, origin + 2, stride_1, stride_0, accumulate_sum );
+      local_sum += stencil_grid_row( array, update_array, origin + row_elts, origin + row_elts + 1, stride_1, stride_0, accumulate_sum );
+    } else {
+      local_sum += stencil_grid_row( array, update_array, origin + 1, origin + row_elts + 1, stride_1, stride_0, accumulate_sum );
+    }
+  } );
+  end_phase( phase_end_fixup, start_time );
+
+  // Swap local array with update array
+  swap_distributed_array_buffers( distributed_array );
+
+  return local_sum;
+}
+
+// \brief Compute one level of a range of a tiled sweep
+// \param src buffer holding the previous level (local index 0)
+// \param dst buffer to write this level into (local index 0)
+// \param begin first local index to compute (may be negative)
+// \param end one past the last local index to compute
+// \param n_elts number of owned elements
+// \param ghost_elts ghost cells on each side of the buffers
+// \param radius stencil radius
+// \param kernel plain radius-r kernel, used outside the owned elements
+// \param sum_kernel summing radius-r kernel, used on the owned elements
+// \return sum of the owned elements computed
+double stencilize_tiled_range( const double* src, double* dst, ptrdiff_t begin, ptrdiff_t end, ptrdiff_t n_elts, ptrdiff_t ghost_elts, size_t radius, stencil_radius_kernel_t kernel, stencil_radius_kernel_t sum_kernel ){
+  // Kernels index from the start of the padding, so all indices are positive
+  const double* const src_base = src - ghost_elts;
+  double* const dst_base = dst - ghost_elts;
+
+  const ptrdiff_t owned_begin = min2( max2( begin, 0 ), end );
+  const ptrdiff_t owned_end   = max2( min2( end, n_elts ), owned_begin );
+
+  double sum = 0.0;
+  if( begin < owned_begin ) kernel( src_base, dst_base, begin + ghost_elts, owned_begin + ghost_elts, radius );
+  if( owned_begin < owned_end ) sum = sum_kernel( src_base, dst_base, owned_begin + ghost_elts, owned_end + ghost_elts, radius );
+  if( owned_end < end ) kernel( src_base, dst_base, owned_end + ghost_elts, end + ghost_elts, radius );
+  return sum;
+}
+
+// \brief Distributed-Parallel "Stencilize" whole distributed array with temporal tiling
+// Every k calls, halos of depth r*k are exchanged (see
+// stencilize_ghost_distributed_array) and all k steps are computed in one
+// cache-blocked sweep. The other k-1 calls do no work.
+// The sweep uses diamond tiling: the level-1 domain is cut into tiles of at
+// least -T elements. In a first parallel phase, each tile computes all k
+// levels of its shrinking (upward) triangle while it stays in cache. In a
+// second parallel phase, the inverted triangles centered on the boundaries
+// between tiles are filled in. Levels alternate between the two buffers, and
+// the triangles are shaped so no value is overwritten before its last use.
+// The sum of the owned elements of every level is accumulated as it is
+// computed, and reported by the call (and sum_local_array) of that level.
+// Note: between the first and last call of a block, the array contents are
+//       already those of the last level of the block.
+// Note: does not synchronize at the end; callers handle
+//       synchronize_at_end_of_distributed_array_operations.
+// \param distributed_array distributed array object (ghost-cell layout) to perform stencil operation on
+// \param accumulate_sum whether to return the sum of this call's level
+// \return sum of this call's level of the local array if accumulate_sum, otherwise 0
+double stencilize_tiled_distributed_array( distributed_array* distributed_array, const bool accumulate_sum ){
+  const ptrdiff_t n_elts = distributed_array->local_elts;
+  const ptrdiff_t ghost_elts = distributed_array->ghost_elts;
+  const ptrdiff_t radius = global_program_context.stencil_radius;
+  const ptrdiff_t depth = global_program_context.temporal_block_depth;
+
+  const bool has_low_neighbor  = global_program_context.rank != 0;
+  const bool has_high_neighbor = global_program_context.rank != global_program_context.n_ranks - 1;
+  const size_t n_neighbors = has_low_neighbor + has_high_neighbor;
+
+  const size_t level = distributed_array->temporal_step;
+
+  if( level == 0 ){
+    // First, exchange halos, with nothing to overlap it with
+    MPI_Request requests[4];
+    MPI_Request* active_requests;
+    int n_requests = start_ghost_halo_exchange( distributed_array, requests, &active_requests );
+    distributed_array->halo_messages_sent += n_neighbors;
+
+    replicate_ghost_ends( distributed_array, distributed_array->local_array, ghost_elts );
+
+    progress_deferred_sum( distributed_array );
+
+    double start_time = start_phase( phase_halo_wait );
+    MPI_Waitall( n_requests, active_requests, MPI_STATUSES_IGNORE );
+    end_phase( phase_halo_wait, start_time );
+
+    // Second, the tiled sweep
+    start_time = start_phase( phase_stencil );
+    double* const buffers[2] = { distributed_array->local_array, distributed_array->update_array };
+
+    // Note: the generic kernel has no radius kernel, it uses the scalar one here
+    stencil_kernel_type_t stencil_kernel_type = global_program_context.stencil_kernel_type;
+    if( stencil_kernel_type == stencil_kernel_generic || stencil_kernel_type == stencil_kernel_templated ) stencil_kernel_type = stencil_kernel_scalar;
+    const stencil_radius_kernel_t kernel     = get_stencil_radius_kernel( stencil_kernel_type, false );
+    const stencil_radius_kernel_t sum_kernel = get_stencil_radius_kernel( stencil_kernel_type, true );
+
+    // Domain of level s is [low_edge(s), high_edge(s)). It shrinks by radius
+    // per level on sides with a neighbor, and is fixed at the ends of the array.
+    #define low_edge( s )  ( has_low_neighbor  ? -radius * ( depth - (s) ) : 0 )
+    #define high_edge( s ) ( has_high_neighbor ? n_elts + radius * ( depth - (s) ) : n_elts )
+
+    // Tiles must be at least as wide as the two sides of the deepest triangle
+    const ptrdiff_t min_tile_elts = 2 * radius * ( depth - 1 );
+    const ptrdiff_t tile_elts = max2( (ptrdiff_t) global_program_context.temporal_tile_elts, max2( min_tile_elts, 1 ) );
+    const ptrdiff_t domain_begin = low_edge( 1 );
+    const ptrdiff_t domain_end   = high_edge( 1 );
+    const ptrdiff_t n_tiles = max2( ( domain_end - domain_begin ) / tile_elts, 1 );
+    // Note: the last tile absorbs the remainder
+    #define tile_boundary( j ) ( ( (j) == n_tiles ) ? domain_end : domain_begin + (j) * tile_elts )
+
+    double* const level_sums = distributed_array->tiled_level_sums;
+    for( ptrdiff_t s = 0; s < depth; ++s ) level_sums[s] = 0.0;
+
+    // Phase A: upward triangles (trapezoids at the domain edges)
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    #pragma omp parallel reduction(+: level_sums[:depth])
+    scheduled_elts_for( n_tiles, tile_index, 0, {
+      const ptrdiff_t tile = tile_index;
+      for( ptrdiff_t s = 1; s <= depth; ++s ){
+        const ptrdiff_t begin = ( tile == 0 )           ? low_edge( s )  : tile_boundary( tile )     + radius * ( s - 1 );
+        const ptrdiff_t end   = ( tile == n_tiles - 1 ) ? high_edge( s ) : tile_boundary( tile + 1 ) - radius * ( s - 1 );
+        double* const dst = buffers[s % 2];
+        level_sums[s-1] += stencilize_tiled_range( buffers[(s-1) % 2], dst, begin, end, n_elts, ghost_elts, radius, kernel, sum_kernel );
+        count_thread_elts( end - begin );
+
+        // The ends of the whole array are computed by the edge tiles, which
+        // also provide this level's replicated ghost cells
+        if( tile == 0           && ! has_low_neighbor  ) for( ptrdiff_t j = 1; j <= radius; ++j ) dst[-j] = dst[0];
+        if( tile == n_tiles - 1 && ! has_high_neighbor ) for( ptrdiff_t j = 0; j < radius; ++j ) dst[n_elts + j] = dst[n_elts - 1];
+      }
+    } );
+
+    // Phase B: inverted triangles centered on the boundaries between tiles
+    #pragma omp parallel reduction(+: level_sums[:depth])
+    scheduled_elts_for( n_tiles - 1, boundary_index, 0, {
+      const ptrdiff_t boundary = boundary_index + 1;
+      for( ptrdiff_t s = 2; s <= depth; ++s ){
+        const ptrdiff_t begin = tile_boundary( boundary ) - radius * ( s - 1 );
+        const ptrdiff_t end   = tile_boundary( boundary ) + radius * ( s - 1 );
+        level_sums[s-1] += stencilize_tiled_range( buffers[(s-1) % 2], buffers[s % 2], begin, end, n_elts, ghost_elts, radius, kernel, sum_kernel );
+        count_thread_elts( end - begin );
+      }
+    } );
+
+    // Redundant updates are the same as stepping through the block one level at a time
+    for( ptrdiff_t s = 1; s <= depth; ++s ){
+      distributed_array->redundant_updates += ( 0 - low_edge( s ) ) + ( high_edge( s ) - n_elts );
+    }
+
+    #undef tile_boundary
+    #undef high_edge
+    #undef low_edge
+
+    // The last level is in buffers[depth % 2]
+    if( depth % 2 == 1 ){
+      swap_distributed_array_buffers( distributed_array );
+    }
+    end_phase( phase_stencil, start_time );
+  } else {
+    // Nothing to compute, but the deferred sum is completed at the same point
+    progress_deferred_sum( distributed_array );
+    distributed_array->halo_messages_saved += n_neighbors;
+  }
+
+  distributed_array->tiled_level = level + 1;
+  distributed_array->temporal_step = ( level + 1 ) % depth;
+
+  return accumulate_sum ? distributed_array->tiled_level_sums[level] : 0.0;
 }
 
 // \brief Distributed-Parallel "Stencilize" whole distributed array
@@ -746,17 +4134,35 @@ void in_place_stencilize_local_array( distributed_array* distributed_array ){
 // and the function is applied to those neighborhood, and thus the stencilize
 // operation always results in the same array regardless of if and how it is
 // distributed (both in terms of number of processes, and in work distribution).
+// When summing, the local sum is accumulated while the local stencil writes the
+// update array, and corrected for the two end values once the halos arrive.
+// Note: does not synchronize at the end; callers handle
+//       synchronize_at_end_of_distributed_array_operations.
 // \param distributed_array distributed array object to perform stencil operation on
-void in_place_stencilize_distributed_array( distributed_array* distributed_array ){
+// \param accumulate_sum whether to sum the updated local array in the same pass
+// \return sum of the updated local array if accumulate_sum, otherwise 0
+double stencilize_distributed_array( distributed_array* distributed_array, const bool accumulate_sum ){
+  // Grids, temporal tiling and the ghost-cell layout have their own, uniform, implementations
+  if( distributed_array->n_dims > 1 ){
+    return stencilize_grid_distributed_array( distributed_array, accumulate_sum );
+  }
+  if( distributed_array->tiled_level_sums != NULL ){
+    return stencilize_tiled_distributed_array( distributed_array, accumulate_sum );
+  }
+  if( distributed_array->ghost_elts > 0 ){
+    return stencilize_ghost_distributed_array( distributed_array, accumulate_sum );
+  }
+
   // First, need to make copies of the end_values of our local
+  // Note: halos are exchanged in double, whatever the element type
   double end_0_neighborhood[3] = {
     0.0, // Will recieve later
-    distributed_array->local_array[0], // Will send later
-    distributed_array->local_array[1]
+    load_local_element( distributed_array, 0 ), // Will send later
+    load_local_element( distributed_array, 1 )
   };
   double end_n_neighborhood[3] = {
-    distributed_array->local_array[distributed_array->local_elts - 2],
-    distributed_array->local_array[distributed_array->local_elts - 1], // Will send later
+    load_local_element( distributed_array, distributed_array->local_elts - 2 ),
+    load_local_element( distributed_array, distributed_array->local_elts - 1 ), // Will send later
     0.0 // Will recieve later
   };
 
@@ -771,46 +4177,65 @@ void in_place_stencilize_distributed_array( distributed_array* distributed_array
   size_t n_recvs = 0;
   size_t n_sends = 0;
 
-  // Send/recieve low side
-  if( global_program_context.rank != 0 ){
-    int send_err = MPI_Isend( &end_0_neighborhood[1], 1, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &send_requests[n_sends] );
-    if( send_err != MPI_SUCCESS ){
-      fprintf( stderr, "Error during end 0 MPI_Isend call: %d", send_err );
-      exit(-1);
-    }
-    n_sends += 1;
+  if( global_program_context.halo_exchange_type == halo_exchange_persistent ){
+    // Persistent requests were created on fixed buffers, copy the end values
+    // into the send buffers and start everything at once.
+    distributed_array->halo_buffers[halo_send_low]  = end_0_neighborhood[1];
+    distributed_array->halo_buffers[halo_send_high] = end_n_neighborhood[1];
 
-    int recv_err = MPI_Irecv( &end_0_neighborhood[0], 1, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &recv_requests[n_recvs] );
-    if( recv_err != MPI_SUCCESS ){
-      fprintf( stderr, "Error during end 0 MPI_Irecv call: %d", recv_err );
+    int start_err = MPI_Startall( distributed_array->n_halo_requests, distributed_array->halo_requests[0] );
+    if( start_err != MPI_SUCCESS ){
+      fprintf( stderr, "Error during MPI_Startall call: %d", start_err );
       exit(-1);
     }
+  } else {
+    // Send/recieve low side
+    if( global_program_context.rank != 0 ){
+      int send_err = MPI_Isend( &end_0_neighborhood[1], 1, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &send_requests[n_sends] );
+      if( send_err != MPI_SUCCESS ){
+        fprintf( stderr, "Error during end 0 MPI_Isend call: %d", send_err );
+        exit(-1);
+      }
+      n_sends += 1;
 
-    n_recvs += 1;
-  }
+      int recv_err = MPI_Irecv( &end_0_neighborhood[0], 1, MPI_DOUBLE, global_program_context.rank - 1, 0, global_program_context.comm, &recv_requests[n_recvs] );
+      if( recv_err != MPI_SUCCESS ){
+        fprintf( stderr, "Error during end 0 MPI_Irecv call: %d", recv_err );
+        exit(-1);
+      }
 
-  // Send/recieve high side
-  if( global_program_context.rank != global_program_context.n_ranks - 1 ){
-    int send_err = MPI_Isend( &end_n_neighborhood[1], 1, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &send_requests[n_sends] );
-    if( send_err != MPI_SUCCESS ){
-      fprintf( stderr, "Error during end N MPI_Isend call: %d", send_err );
-      exit(-1);
+      n_recvs += 1;
     }
-    n_sends += 1;
 
-    int recv_err = MPI_Irecv( &end_n_neighborhood[2], 1, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &recv_requests[n_recvs] );
-    if( recv_err != MPI_SUCCESS ){
-      fprintf( stderr, "Error during end N MPI_Irecv call: %d", recv_err );
-      exit(-1);
+    // Send/recieve high side
+    if( global_program_context.rank != global_program_context.n_ranks - 1 ){
+      int send_err = MPI_Isend( &end_n_neighborhood[1], 1, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &send_requests[n_sends] );
+      if( send_err != MPI_SUCCESS ){
+        fprintf( stderr, "Error during end N MPI_Isend call: %d", send_err );
+        exit(-1);
+      }
+      n_sends += 1;
+
+      int recv_err = MPI_Irecv( &end_n_neighborhood[2], 1, MPI_DOUBLE, global_program_context.rank + 1, 0, global_program_context.comm, &recv_requests[n_recvs] );
+      if( recv_err != MPI_SUCCESS ){
+        fprintf( stderr, "Error during end N MPI_Irecv call: %d", recv_err );
+        exit(-1);
+      }
+
+      n_recvs += 1;
     }
-
-    n_recvs += 1;
   }
 
   // Third, perform local stencilization
   // Note: This happens in parallel with the send.
   // TODO: should there be an option to synchronize before computing?
-  in_place_stencilize_local_array( distributed_array );
+  double start_time = start_phase( phase_stencil );
+  double local_sum = stencilize_local_array( distributed_array, accumulate_sum );
+  end_phase( phase_stencil, start_time );
+
+  // Complete the previous iteration's deferred sum, if any, now that the local
+  // stencil has had time to overlap with it.
+  progress_deferred_sum( distributed_array );
 
 
   // Fourth, complete recieves
@@ -818,53 +4243,153 @@ void in_place_stencilize_distributed_array( distributed_array* distributed_array
   //       index the send is copying from
   // Note: *could* do computation while waiting for other recieve to come it,
   //       but not worth the effort right now.
+  start_time = start_phase( phase_halo_wait );
   for( size_t recv_i = 0; recv_i < n_recvs; ++recv_i ){
     MPI_Wait( &recv_requests[recv_i], NULL );
   }
 
+  // Persistent requests complete sends and recieves together, so the send
+  // buffers are free to be rewritten by the next stencil.
+  if( global_program_context.halo_exchange_type == halo_exchange_persistent ){
+    MPI_Waitall( distributed_array->n_halo_requests, distributed_array->halo_requests[0], MPI_STATUSES_IGNORE );
+    if( global_program_context.rank != 0 ){
+      end_0_neighborhood[0] = distributed_array->halo_buffers[halo_recv_low];
+    }
+    if( global_program_context.rank != global_program_context.n_ranks - 1 ){
+      end_n_neighborhood[2] = distributed_array->halo_buffers[halo_recv_high];
+    }
+  }
+  end_phase( phase_halo_wait, start_time );
+
 
   // Fifth, compute ends
+  start_time = start_phase( phase_end_fixup );
+
   // Compute low side
   if( global_program_context.rank != 0 ){
-    double max_val = max3( end_0_neighborhood[0], end_0_neighborhood[1], end_0_neighborhood[2] );
-    double min_val = min3( end_0_neighborhood[0], end_0_neighborhood[1], end_0_neighborhood[2] );
+    double end_value = stencil_end_element( end_0_neighborhood[0], end_0_neighborhood[1], end_0_neighborhood[2] );
 
-    distributed_array->local_array[0] =  max_val / (1 + abs(min_val) );
+    // Note: the sum takes the value as stored, in the element type
+    const double truncated_value = load_local_element( distributed_array, 0 );
+    store_local_element( distributed_array, 0, end_value );
+    if( accumulate_sum ) local_sum += load_local_element( distributed_array, 0 ) - truncated_value;
   }
 
   // Compute high side
   if( global_program_context.rank != global_program_context.n_ranks - 1 ){
-    double max_val = max3( end_n_neighborhood[0], end_n_neighborhood[1], end_n_neighborhood[2] );
-    double min_val = min3( end_n_neighborhood[0], end_n_neighborhood[1], end_n_neighborhood[2] );
+    double end_value = stencil_end_element( end_n_neighborhood[0], end_n_neighborhood[1], end_n_neighborhood[2] );
 
-    distributed_array->local_array[distributed_array->local_elts - 1] =  max_val / (1 + abs(min_val) );
+    const size_t end_index = distributed_array->local_elts - 1;
+    const double truncated_value = load_local_element( distributed_array, end_index );
+    store_local_element( distributed_array, end_index, end_value );
+    if( accumulate_sum ) local_sum += load_local_element( distributed_array, end_index ) - truncated_value;
   }
+  end_phase( phase_end_fixup, start_time );
 
   // Sixth, wait on sends just because
+  // Note: no sends are outstanding here with persistent requests.
   // I'm 99% sure this is unnecessary, especially since there is no error
   // handling here.
+  start_time = start_phase( phase_halo_wait );
   for( size_t send_i = 0; send_i < n_sends; ++send_i ){
     MPI_Wait( &send_requests[send_i], NULL );
   }
+  end_phase( phase_halo_wait, start_time );
+
+  return local_sum;
+}
+
+// \brief Distributed-Parallel "Stencilize" whole distributed array
+// See stencilize_distributed_array.
+// \param distributed_array distributed array object to perform stencil operation on
+void in_place_stencilize_distributed_array( distributed_array* distributed_array ){
+  stencilize_distributed_array( distributed_array, false );
 
   // Done
   if( global_program_context.synchronize_at_end_of_distributed_array_operations ){
+    double start_time = start_phase( phase_barrier );
     MPI_Barrier( global_program_context.comm );
+    end_phase( phase_barrier, start_time );
+  }
+}
+
+// \brief Sum a contiguous range of a local array
+// Note: branch-free, vectorized with a SIMD reduction, for the default order.
+// \param array local array
+// \param begin first local index to sum
+// \param end one past the last local index to sum
+// \return sum of array[begin, end)
+static inline double sum_local_range( const double* restrict array, size_t begin, size_t end ){
+  double sum = 0.0;
+  #pragma omp simd reduction(+: sum)
+  for( size_t i = begin; i < end; ++i ){
+    sum += array[i];
   }
+  return sum;
 }
 
 // \brief Parallel sum local portion of distributed array
 // \param distributed_array distributed array object whose local array elements will be summed.
 // \return the value of the sum of the distributed array object's local array
 double sum_local_array( distributed_array* distributed_array ){
+  // The tiled stencil already summed every level as it computed it
+  if( distributed_array->tiled_level_sums != NULL && distributed_array->tiled_level > 0 ){
+    return distributed_array->tiled_level_sums[distributed_array->tiled_level - 1];
+  }
+
   double rank_local_sum = 0.0;
 
-  // Note: Schedule and chunk-size were set at program init.
-  //       There should be no reason to need any scheduling causes here.
-  #pragma omp parallel for reduction(+: rank_local_sum)
+  // Grids are summed row by row, skipping the ghost cells
+  if( distributed_array->n_dims > 1 ){
+    const size_t row_elts = distributed_array->grid_local_dims[2];
+
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    #pragma omp parallel reduction(+: rank_local_sum)
+    scheduled_elts_for( grid_n_rows( distributed_array ), row, row_elts, {
+      const size_t origin = grid_row_origin( distributed_array, row );
+      rank_local_sum += sum_local_range( distributed_array->local_array, origin + 1, origin + row_elts + 1 );
+    } );
+    return rank_local_sum;
+  }
+
+  // The templated core has a kernel for every order, handed out in blocks of positions
+  if( global_program_context.stencil_kernel_type == stencil_kernel_templated ){
+    const core_kernels_t kernels = get_distributed_array_core_kernels( distributed_array );
+    const core_view_t view = get_distributed_array_core_view( distributed_array );
+    const size_t n_elts = distributed_array->local_elts;
+    const size_t n_blocks = ( n_elts + LOCAL_KERNEL_BLOCK_ELTS - 1 ) / LOCAL_KERNEL_BLOCK_ELTS;
+
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    #pragma omp parallel reduction(+: rank_local_sum)
+    scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+      const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+      rank_local_sum += kernels.sum( &view, begin, min2( begin + LOCAL_KERNEL_BLOCK_ELTS, n_elts ) );
+    } );
+    advance_iteration_order( distributed_array );
+    return rank_local_sum;
+  }
+
+  // Default order is handed out in blocks, to a branch-free SIMD kernel
+  if( has_default_iteration_order( distributed_array ) ){
+    const size_t n_elts = distributed_array->local_elts;
+    const size_t n_blocks = ( n_elts + LOCAL_KERNEL_BLOCK_ELTS - 1 ) / LOCAL_KERNEL_BLOCK_ELTS;
+
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    #pragma omp parallel reduction(+: rank_local_sum)
+    scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+      const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+      rank_local_sum += sum_local_range( distributed_array->local_array, begin, min2( begin + LOCAL_KERNEL_BLOCK_ELTS, n_elts ) );
+    } );
+    return rank_local_sum;
+  }
+
+  // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+  #pragma omp parallel reduction(+: rank_local_sum)
   distributed_array_local_for(
     distributed_array,
     i,
+    distributed_array->local_array,
+    NULL,
     {
       rank_local_sum += distributed_array->local_array[i];
     }
@@ -873,49 +4398,784 @@ double sum_local_array( distributed_array* distributed_array ){
   return rank_local_sum;
 }
 
-// \brief Distributed-Parallel sum a distributed array
-// All ranks communicate their local sums to the primary, who computes the
-// final value.
-// \return value of sum (only if called on primary rank or if
-//   global_program_context.synchronize_at_end_of_distributed_array_operations
-//   set).
-double sum_distributed_array( distributed_array* distributed_array ){
-  // Array where (on primary) sums will be gathered into
-  double* all_sums = NULL ;
+// \brief Find the fastest prefetch distance for the local loops
+// Times the local stencil and sum (no communication) over a range of prefetch
+// distances, reports the times (max across ranks), and sets
+// global_prefetch_distance to the fastest. Leaves the values of the array
+// unspecified, and its indirection arrays rotated back to the first.
+// \param distributed_array distributed array object to time the loops on
+void sweep_prefetch_distance( distributed_array* distributed_array ){
+  const size_t distances[] = { 0, 1, 2, 4, 8, 16, 32, 64, 128, 256 };
+  const size_t n_distances = sizeof(distances) / sizeof(distances[0]);
+  // Every indirection array is used the same number of times per distance
+  const int repetitions = distributed_array->n_indirection_arrays;
+
+  size_t best_distance = 0;
+  double best_seconds = INFINITY;
+  for( size_t d = 0; d < n_distances; ++d ){
+    global_prefetch_distance = distances[d];
 
-  // Only allocate/free on primary
-  if( global_program_context.rank == global_program_context.primary_rank ){
-    all_sums = (double*) malloc( global_program_context.n_ranks * sizeof(double) );
+    MPI_Barrier( global_program_context.comm );
+    const double start_time = MPI_Wtime();
+    for( int repetition = 0; repetition < repetitions; ++repetition ){
+      stencilize_local_array( distributed_array, false );
+      sum_local_array( distributed_array );
+    }
+    double seconds = MPI_Wtime() - start_time;
+    MPI_Allreduce( MPI_IN_PLACE, &seconds, 1, MPI_DOUBLE, MPI_MAX, global_program_context.comm );
+
+    if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
+      printf( "Prefetch distance %3lu: %f s for %d local stencils and sums\n", distances[d], seconds, repetitions );
+    }
+    if( seconds < best_seconds ){
+      best_seconds = seconds;
+      best_distance = distances[d];
+    }
   }
 
-  // Perform reduction on local portion of array
-  double rank_local_sum = sum_local_array( distributed_array );
+  global_prefetch_distance = best_distance;
+  distributed_array->indirection_array_next = 0;
+
+  if( global_program_context.verbosity >= verbosity_less && global_program_context.rank == global_program_context.primary_rank ){
+    printf( "Best prefetch distance: %lu\n", best_distance );
+  }
+}
 
-  // Gather all local reduction
-  MPI_Gather( &rank_local_sum, 1, MPI_DOUBLE, all_sums, 1, MPI_DOUBLE, global_program_context.primary_rank, global_program_context.comm );
+// \brief Reduce per-rank local sums into the distributed sum
+// The strategy is selected with -r:
+//   "gather"     : All ranks communicate their local sums to the primary, who
+//                  computes the final value.
+//   "reduce"     : MPI_Reduce to the primary.
+//   "allreduce"  : MPI_Allreduce, every rank gets the final value.
+//   "iallreduce" : MPI_Iallreduce is started and NAN is returned; the result is
+//                  completed during the next stencil and must be picked up with
+//                  collect_deferred_sum.
+// Time spent here (and completing deferred reductions) is accumulated into
+// global_phase_seconds[phase_reduce].
+// \param distributed_array distributed array object the local sum belongs to
+// \param rank_local_sum this rank's local sum
+// \return value of sum (only if called on primary rank, or on any rank with
+//   "allreduce")
+double reduce_local_sums( distributed_array* distributed_array, double rank_local_sum ){
+  double start_time = start_phase( phase_reduce );
 
-  // Primary computes final part of reduction locally
   double sum = 0.0;
-  if( global_program_context.rank == global_program_context.primary_rank ){
-    // Local Sum
-    for( size_t i = 0; i < global_program_context.n_ranks; ++i ){
-      sum += all_sums[i];
+  switch( global_program_context.reduction_type ){
+    case reduction_gather: {
+      // Array where (on primary) sums will be gathered into
+      double* all_sums = NULL ;
+
+      // Only allocate/free on primary
+      if( global_program_context.rank == global_program_context.primary_rank ){
+        all_sums = (double*) counted_malloc( global_program_context.n_ranks * sizeof(double) );
+      }
+
+      // Gather all local reduction
+      MPI_Gather( &rank_local_sum, 1, MPI_DOUBLE, all_sums, 1, MPI_DOUBLE, global_program_context.primary_rank, global_program_context.comm );
+
+      // Primary computes final part of reduction locally
+      if( global_program_context.rank == global_program_context.primary_rank ){
+        // Local Sum
+        for( size_t i = 0; i < global_program_context.n_ranks; ++i ){
+          sum += all_sums[i];
+        }
+
+        // Only allocate/free on primary
+        free( all_sums );
+      }
+    }
+    break;
+
+    case reduction_reduce: {
+      MPI_Reduce( &rank_local_sum, &sum, 1, MPI_DOUBLE, MPI_SUM, global_program_context.primary_rank, global_program_context.comm );
+
+      // Note: receive buffer is only written on the primary
+      if( global_program_context.rank != global_program_context.primary_rank ){
+        sum = 0.0;
+      }
+    }
+    break;
+
+    case reduction_allreduce: {
+      MPI_Allreduce( &rank_local_sum, &sum, 1, MPI_DOUBLE, MPI_SUM, global_program_context.comm );
     }
+    break;
+
+    case reduction_iallreduce: {
+      // Normally completed by the stencil already, but never have two in flight
+      progress_deferred_sum( distributed_array );
 
-    // Only allocate/free on primary
-    free( all_sums );
+      distributed_array->sum_request_local = rank_local_sum;
+      MPI_Iallreduce( &distributed_array->sum_request_local, &distributed_array->sum_request_global, 1, MPI_DOUBLE, MPI_SUM, global_program_context.comm, &distributed_array->sum_request );
+      sum = NAN;
+    }
+    break;
   }
 
+  end_phase( phase_reduce, start_time );
+
   if( global_program_context.synchronize_at_end_of_distributed_array_operations ){
     // Thought about doing a Bcast of sum here, but I imagine that this is not
     // as "ineffecient" as the spirit of this synchronization option would want.
+    start_time = start_phase( phase_barrier );
     MPI_Barrier( global_program_context.comm );
+    end_phase( phase_barrier, start_time );
   }
 
-  // Note: returns zero if not calling on the primary rank
+  // Note: returns zero if not calling on the primary rank (except "allreduce"),
+  //       and NAN if the reduction was deferred.
   return  sum;
 }
 
+// \brief Maximum magnitude of a contiguous range of a local array
+// \param array local array
+// \param begin first local index
+// \param end one past the last local index
+// \return maximum of |array[begin, end)|, 0 if empty
+static inline double max_magnitude_local_range( const double* restrict array, size_t begin, size_t end ){
+  double max_val = 0.0;
+  #pragma omp simd reduction(max: max_val)
+  for( size_t i = begin; i < end; ++i ){
+    max_val = max2( max_val, fabs( array[i] ) );
+  }
+  return max_val;
+}
+
+// Adding then subtracting 1.5 * 2^52 rounds values below 2^51 to the nearest integer
+#define REPRODUCIBLE_SUM_ROUND_CONSTANT 0x1.8p52
+
+// \brief Sum the pre-rounded parts of a contiguous range of a local array
+// Note: the parts are integers below 2^REPRODUCIBLE_SUM_FOLD_BITS, so the
+//       sums of up to LOCAL_KERNEL_BLOCK_ELTS of them are exact, in any order.
+// \param array local array
+// \param begin first local index
+// \param end one past the last local index, at most LOCAL_KERNEL_BLOCK_ELTS after begin
+// \param scale scale of the elements, see reproducible_sum_distributed_array
+// \param fold scale of the remainders, 2^REPRODUCIBLE_SUM_FOLD_BITS
+// \return exact sums of the range's parts
+static inline reproducible_sum_t reproducible_sum_local_range( const double* restrict array, size_t begin, size_t end, const double scale, const double fold ){
+  double high = 0.0;
+  double low = 0.0;
+  #pragma omp simd reduction(+: high, low)
+  for( size_t i = begin; i < end; ++i ){
+    const double y = array[i] * scale;
+    const double q = ( y + REPRODUCIBLE_SUM_ROUND_CONSTANT ) - REPRODUCIBLE_SUM_ROUND_CONSTANT;
+    high += q;
+    low  += ( ( y - q ) * fold + REPRODUCIBLE_SUM_ROUND_CONSTANT ) - REPRODUCIBLE_SUM_ROUND_CONSTANT;
+  }
+  return (reproducible_sum_t){ (int64_t) high, (int64_t) low };
+}
+
+// \brief Reproducible Distributed-Parallel sum of a distributed array
+// Every element x is pre-rounded against the global maximum magnitude M:
+// y = x * 2^s, with s such that |y| < 2^40, is split into its nearest integer
+// q and the remainder y - q (both exact), the remainder is scaled by 2^40 and
+// rounded to an integer the same way. Both parts of every element only
+// depend on x and M, and are summed exactly (in 128-bit integers), so the sum
+// does not depend on the order of the additions (threads, schedule, ranks).
+// It is rounded to double once, at the end.
+// Time spent in the two MPI_Allreduce is accumulated into global_phase_seconds[phase_reduce],
+// and in the local passes into global_phase_seconds[phase_sum].
+// \param distributed_array distributed array object to sum (double precision)
+// \return value of sum, on every rank
+double reproducible_sum_distributed_array( distributed_array* distributed_array ){
+  const double* const array = distributed_array->local_array;
+
+  const size_t n_elts = distributed_array->local_elts;
+  const size_t n_blocks = ( n_elts + LOCAL_KERNEL_BLOCK_ELTS - 1 ) / LOCAL_KERNEL_BLOCK_ELTS;
+  const bool default_order = has_default_iteration_order( distributed_array );
+
+  // First, the global maximum magnitude
+  double start_time = start_phase( phase_sum );
+  double local_max = 0.0;
+
+  // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+  if( default_order ){
+    #pragma omp parallel reduction(max: local_max)
+    scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+      const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+      local_max = max2( local_max, max_magnitude_local_range( array, begin, min2( begin + LOCAL_KERNEL_BLOCK_ELTS, n_elts ) ) );
+    } );
+  } else {
+    #pragma omp parallel reduction(max: local_max)
+    distributed_array_local_for(
+      distributed_array,
+      i,
+      array,
+      NULL,
+      {
+        local_max = max2( local_max, fabs( array[i] ) );
+      }
+    );
+  }
+
+  end_phase( phase_sum, start_time );
+
+  start_time = start_phase( phase_reduce );
+  double global_max;
+  MPI_Allreduce( &local_max, &global_max, 1, MPI_DOUBLE, MPI_MAX, global_program_context.comm );
+  end_phase( phase_reduce, start_time );
+
+  // No exact sum of infinities or NaN
+  if( ! isfinite( global_max ) ) return NAN;
+
+  // Second, the exact sums of the parts
+  // Note: global_max < 2^exponent, and the scale is kept finite for tiny maxima
+  int exponent;
+  frexp( global_max, &exponent );
+  const int scale_exponent = min2( REPRODUCIBLE_SUM_FOLD_BITS - exponent, 1023 );
+  const double scale = ldexp( 1.0, scale_exponent );
+  const double fold = ldexp( 1.0, REPRODUCIBLE_SUM_FOLD_BITS );
+
+  start_time = start_phase( phase_sum );
+  reproducible_sum_t rank_sum = { 0, 0 };
+
+  #pragma omp parallel
+  {
+    __int128 thread_high = 0;
+    __int128 thread_low = 0;
+
+    // Note: the loop schedule (-l, -c) is applied by scheduled_for.
+    if( default_order ){
+      scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+        const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+        const reproducible_sum_t block_sum = reproducible_sum_local_range( array, begin, min2( begin + LOCAL_KERNEL_BLOCK_ELTS, n_elts ), scale, fold );
+        thread_high += block_sum.high;
+        thread_low  += block_sum.low;
+      } );
+    } else {
+      distributed_array_local_for(
+        distributed_array,
+        i,
+        array,
+        NULL,
+        {
+          const double y = array[i] * scale;
+          const double q = ( y + REPRODUCIBLE_SUM_ROUND_CONSTANT ) - REPRODUCIBLE_SUM_ROUND_CONSTANT;
+          const double r = ( ( y - q ) * fold + REPRODUCIBLE_SUM_ROUND_CONSTANT ) - REPRODUCIBLE_SUM_ROUND_CONSTANT;
+          thread_high += (int64_t) q;
+          thread_low  += (int64_t) r;
+        }
+      );
+    }
+
+    #pragma omp critical
+    {
+      rank_sum.high += thread_high;
+      rank_sum.low  += thread_low;
+    }
+  }
+
+  end_phase( phase_sum, start_time );
+
+  start_time = start_phase( phase_reduce );
+  reproducible_sum_t sum;
+  MPI_Allreduce( &rank_sum, &sum, 1, global_reproducible_sum_type, global_reproducible_sum_op, global_program_context.comm );
+  end_phase( phase_reduce, start_time );
+
+  // Carry the whole units of the low part, then round once
+  sum.high += sum.low >> REPRODUCIBLE_SUM_FOLD_BITS;
+  sum.low  &= ( (__int128) 1 << REPRODUCIBLE_SUM_FOLD_BITS ) - 1;
+  return ldexp( (double) sum.high + ldexp( (double) sum.low, -REPRODUCIBLE_SUM_FOLD_BITS ), -scale_exponent );
+}
+
+// \brief Time the reproducible sum against the plain one
+// Sums the array repetitions times each way, the plain way being the
+// OpenMP reduction of sum_local_array followed by an MPI_Allreduce, and
+// reports the times (max across ranks) and the difference of the sums.
+// \param distributed_array distributed array object to sum (double precision)
+// \param repetitions number of sums to time each way
+void report_reproducible_sum_overhead( distributed_array* distributed_array, const int repetitions ){
+  double plain_sum = 0.0;
+  double reproducible_sum = 0.0;
+
+  MPI_Barrier( global_program_context.comm );
+  const double plain_start_time = MPI_Wtime();
+  for( int repetition = 0; repetition < repetitions; ++repetition ){
+    double rank_local_sum = sum_local_array( distributed_array );
+    MPI_Allreduce( &rank_local_sum, &plain_sum, 1, MPI_DOUBLE, MPI_SUM, global_program_context.comm );
+  }
+  const double plain_seconds = MPI_Wtime() - plain_start_time;
+
+  MPI_Barrier( global_program_context.comm );
+  const double reproducible_start_time = MPI_Wtime();
+  for( int repetition = 0; repetition < repetitions; ++repetition ){
+    reproducible_sum = reproducible_sum_distributed_array( distributed_array );
+  }
+  const double reproducible_seconds = MPI_Wtime() - reproducible_start_time;
+
+  double max_seconds[2];
+  const double local_seconds[2] = { plain_seconds, reproducible_seconds };
+  MPI_Reduce( local_seconds, max_seconds, 2, MPI_DOUBLE, MPI_MAX, global_program_context.primary_rank, global_program_context.comm );
+
+  if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
+    printf( "Reproducible sum: %f s for %d sums, plain sum: %f s (overhead %.2fx), plain sum deviates by %e\n", max_seconds[1], repetitions, max_seconds[0], max_seconds[1] / max_seconds[0], plain_sum - reproducible_sum );
+  }
+}
+
+// \brief Distributed-Parallel sum a distributed array
+// See reduce_local_sums, or reproducible_sum_distributed_array with -R.
+// \param distributed_array distributed array object to sum
+// \return value of sum (see reduce_local_sums)
+double sum_distributed_array( distributed_array* distributed_array ){
+  if( global_program_context.reproducible_sum ){
+    return reproducible_sum_distributed_array( distributed_array );
+  }
+
+  // Perform reduction on local portion of array
+  double start_time = start_phase( phase_sum );
+  double rank_local_sum = sum_local_array( distributed_array );
+  end_phase( phase_sum, start_time );
+
+  return reduce_local_sums( distributed_array, rank_local_sum );
+}
+
+// \brief Distributed-Parallel "Stencilize" and sum a distributed array in one pass
+// Equivalent to in_place_stencilize_distributed_array followed by
+// sum_distributed_array, but the local array is only streamed through once.
+// \param distributed_array distributed array object to perform stencil operation on and sum
+// \return value of sum (see reduce_local_sums)
+// Note: the reproducible sum (-R) takes its own passes, after the stencil.
+double stencilize_and_sum_distributed_array( distributed_array* distributed_array ){
+  if( global_program_context.reproducible_sum ){
+    in_place_stencilize_distributed_array( distributed_array );
+    return reproducible_sum_distributed_array( distributed_array );
+  }
+
+  double rank_local_sum = stencilize_distributed_array( distributed_array, true );
+
+  return reduce_local_sums( distributed_array, rank_local_sum );
+}
+
+
+// \brief Run all iterations of stencil and sum on a distributed array
+// \param array initialized distributed array object
+// \param print_iteration_sums whether to print every iteration's sum (at verbosity "more")
+// \return mean of the iterations' sums (on the primary rank)
+double iterate_distributed_array( distributed_array* array, const bool print_iteration_sums ){
+  double mean_sum = 0.0;
+  for( int iteration = 0; iteration < global_program_context.iterations; ++iteration ){
+    double iteration_sum;
+    if( global_program_context.fuse_stencil_and_sum ){
+      // "Stencilize" and sum distributed array in one pass
+      iteration_sum = stencilize_and_sum_distributed_array( array );
+    } else {
+      // "Stencilize" distributed array
+      in_place_stencilize_distributed_array( array );
+
+      // sum distributed array
+      iteration_sum = sum_distributed_array( array );
+    }
+
+    // With a deferred reduction, this iteration's sum is still in flight, but
+    // the previous iteration's sum was completed during this iteration's stencil
+    int summed_iteration = iteration;
+    if( global_program_context.reduction_type == reduction_iallreduce ){
+      summed_iteration = iteration - 1;
+      if( ! collect_deferred_sum( array, &iteration_sum, false ) ) continue;
+    }
+
+    mean_sum += iteration_sum / global_program_context.iterations;
+
+    // Print reduction value
+    // Note: the expression (true | (int)sum) is a trick to force the not optimize
+    // the reduce_distributed_array call to be under this conditional.
+    if( print_iteration_sums && global_program_context.verbosity >= verbosity_more && (true | (int) iteration_sum) && global_program_context.rank == global_program_context.primary_rank ){
+      printf( "Iteration %d sum: %f\n", summed_iteration, iteration_sum );
+    }
+  }
+
+  // Collect the last iteration's deferred sum
+  double last_iteration_sum;
+  if( global_program_context.reduction_type == reduction_iallreduce && collect_deferred_sum( array, &last_iteration_sum, true ) ){
+    mean_sum += last_iteration_sum / global_program_context.iterations;
+
+    if( print_iteration_sums && global_program_context.verbosity >= verbosity_more && global_program_context.rank == global_program_context.primary_rank ){
+      printf( "Iteration %d sum: %f\n", global_program_context.iterations - 1, last_iteration_sum );
+    }
+  }
+
+  return mean_sum;
+}
+
+// \brief Print the min/avg/max across ranks of the seconds spent in every phase
+// The imbalance of a phase is its max over its avg: 1 when all ranks spend the
+// same time, n_ranks when a single rank does all of it.
+// Note: collective, prints on the primary rank.
+void report_phase_seconds( ){
+  double min_seconds[phase_count];
+  double max_seconds[phase_count];
+  double total_seconds[phase_count];
+  MPI_Reduce( global_phase_seconds, min_seconds,   phase_count, MPI_DOUBLE, MPI_MIN, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( global_phase_seconds, max_seconds,   phase_count, MPI_DOUBLE, MPI_MAX, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( global_phase_seconds, total_seconds, phase_count, MPI_DOUBLE, MPI_SUM, global_program_context.primary_rank, global_program_context.comm );
+
+  if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
+    printf( "%-14s %12s %12s %12s %10s\n", "Phase", "min (s)", "avg (s)", "max (s)", "imbalance" );
+    for( int phase = 0; phase < phase_count; ++phase ){
+      const double avg_seconds = total_seconds[phase] / global_program_context.n_ranks;
+      // Note: phases no rank spent time in have no imbalance
+      const double imbalance = ( avg_seconds > 0.0 ) ? max_seconds[phase] / avg_seconds : 1.0;
+      printf( "%-14s %12.6f %12.6f %12.6f %10.3f\n", phase_name( phase ), min_seconds[phase], avg_seconds, max_seconds[phase], imbalance );
+    }
+    if( global_program_context.fuse_stencil_and_sum ){
+      printf( "Note: with -f, the sum is part of the stencil phase\n" );
+    }
+  }
+}
+
+// Bandwidths measured by the machine probe (-b) on this rank, 0 when not probed
+// See probe_machine_peak.
+typedef struct {
+  double copy_gbytes_per_second;   // b[i] = a[i]
+  double triad_gbytes_per_second;  // a[i] = b[i] + q * c[i]
+  double gather_gbytes_per_second; // sum of a[index[i]], over a random index
+} machine_peak_t;
+
+machine_peak_t global_machine_peak = { 0.0, 0.0, 0.0 };
+
+// Timed repetitions of each probe loop, the fastest is kept
+#define MACHINE_PROBE_REPETITIONS 5
+
+// \brief Copy loop of the machine probe over [begin, end)
+void probe_copy_range( double* restrict dst, const double* restrict src, const size_t begin, const size_t end ){
+  #pragma omp simd
+  for( size_t i = begin; i < end; ++i ) dst[i] = src[i];
+}
+
+// \brief Triad loop of the machine probe over [begin, end)
+void probe_triad_range( double* restrict dst, const double* restrict src, const double* restrict scaled, const double q, const size_t begin, const size_t end ){
+  #pragma omp simd
+  for( size_t i = begin; i < end; ++i ) dst[i] = src[i] + q * scaled[i];
+}
+
+// \brief Gather loop of the machine probe over [begin, end)
+// \return sum of the gathered elements
+double probe_gather_range( const double* restrict src, const size_t* restrict indices, const size_t begin, const size_t end ){
+  double sum = 0.0;
+  for( size_t i = begin; i < end; ++i ) sum += src[indices[i]];
+  return sum;
+}
+
+// \brief Measure this rank's memory bandwidth, into global_machine_peak
+// Copy, triad and random-gather loops over probe_elts elements (-b), with the
+// same threads, loop schedule and allocation path as the distributed array:
+// the arrays are allocated with counted_malloc and first touched by the
+// scheduled loop, in blocks of LOCAL_KERNEL_BLOCK_ELTS, and the random index
+// is a "random" order indirection array. All ranks run each loop at the same
+// time, as in the iterations, and the fastest of MACHINE_PROBE_REPETITIONS
+// is kept. Bytes are counted as in model_kernel: copy moves 16 bytes per
+// element, triad 24, and gather a cache line plus its index.
+// Note: collective.
+void probe_machine_peak( ){
+  const size_t n_elts = global_program_context.probe_elts;
+  const size_t n_blocks = ( n_elts + LOCAL_KERNEL_BLOCK_ELTS - 1 ) / LOCAL_KERNEL_BLOCK_ELTS;
+  double* a = (double*) counted_malloc( n_elts * sizeof(double) );
+  double* b = (double*) counted_malloc( n_elts * sizeof(double) );
+  double* c = (double*) counted_malloc( n_elts * sizeof(double) );
+  size_t* indices = create_local_indirection_array( n_elts, iteration_order_random_order, 0 );
+
+  #pragma omp parallel
+  scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+    const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+    const size_t end = begin + local_kernel_block_elts( block, n_elts );
+    for( size_t i = begin; i < end; ++i ){
+      a[i] = 1.0;
+      b[i] = 2.0;
+      c[i] = 0.0;
+    }
+  } );
+
+  double best_seconds[3] = { INFINITY, INFINITY, INFINITY };
+  double gathered = 0.0;
+  for( int repetition = 0; repetition < MACHINE_PROBE_REPETITIONS; ++repetition ){
+    MPI_Barrier( global_program_context.comm );
+    double start_time = MPI_Wtime();
+    #pragma omp parallel
+    scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+      const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+      probe_copy_range( c, a, begin, begin + local_kernel_block_elts( block, n_elts ) );
+    } );
+    best_seconds[0] = min2( best_seconds[0], MPI_Wtime() - start_time );
+
+    MPI_Barrier( global_program_context.comm );
+    start_time = MPI_Wtime();
+    #pragma omp parallel
+    scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+      const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+      probe_triad_range( a, b, c, 3.0, begin, begin + local_kernel_block_elts( block, n_elts ) );
+    } );
+    best_seconds[1] = min2( best_seconds[1], MPI_Wtime() - start_time );
+
+    MPI_Barrier( global_program_context.comm );
+    start_time = MPI_Wtime();
+    #pragma omp parallel reduction(+: gathered)
+    scheduled_elts_for( n_blocks, block, local_kernel_block_elts( block, n_elts ), {
+      const size_t begin = block * LOCAL_KERNEL_BLOCK_ELTS;
+      gathered += probe_gather_range( a, indices, begin, begin + local_kernel_block_elts( block, n_elts ) );
+    } );
+    best_seconds[2] = min2( best_seconds[2], MPI_Wtime() - start_time );
+  }
+
+  // Note: printed with -v debug, so the gathers are not optimized away
+  if( global_program_context.verbosity >= verbosity_debug ){
+    printf( "Rank %d probe gathered %f\n", global_program_context.rank, gathered );
+  }
+
+  global_machine_peak.copy_gbytes_per_second   = n_elts * 2.0 * sizeof(double) * 1e-9 / best_seconds[0];
+  global_machine_peak.triad_gbytes_per_second  = n_elts * 3.0 * sizeof(double) * 1e-9 / best_seconds[1];
+  global_machine_peak.gather_gbytes_per_second = n_elts * (double)( CACHE_LINE_BYTES + sizeof(size_t) ) * 1e-9 / best_seconds[2];
+
+  free( indices );
+  free( c );
+  free( b );
+  free( a );
+
+  const double peaks[3] = { global_machine_peak.copy_gbytes_per_second, global_machine_peak.triad_gbytes_per_second, global_machine_peak.gather_gbytes_per_second };
+  double min_peaks[3], max_peaks[3], total_peaks[3];
+  MPI_Reduce( peaks, min_peaks,   3, MPI_DOUBLE, MPI_MIN, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( peaks, max_peaks,   3, MPI_DOUBLE, MPI_MAX, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( peaks, total_peaks, 3, MPI_DOUBLE, MPI_SUM, global_program_context.primary_rank, global_program_context.comm );
+
+  if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
+    const char* names[3] = { "copy", "triad", "gather" };
+    printf( "Machine probe over %lu elements per rank, %d threads per rank:\n", n_elts, global_program_context.omp_num_threads );
+    printf( "%-14s %10s %10s %10s %10s\n", "Probe", "min GB/s", "avg GB/s", "max GB/s", "total GB/s" );
+    for( int probe = 0; probe < 3; ++probe ){
+      printf( "%-14s %10.3f %10.3f %10.3f %10.3f\n", names[probe], min_peaks[probe], total_peaks[probe] / global_program_context.n_ranks, max_peaks[probe], total_peaks[probe] );
+    }
+  }
+}
+
+// Analytic traffic and arithmetic of a kernel, per element it processes
+// See model_kernel.
+typedef struct {
+  double bytes; // bytes moved to and from memory
+  double flops; // floating point operations
+} kernel_model_t;
+
+// \brief Bytes moved by one access to an element in the program's iteration order
+// Orders that visit neighboring elements close together move each element once;
+// orders that scatter the accesses move a whole cache line per access.
+// \param element_bytes bytes per element
+// \return bytes moved per access
+double element_access_bytes( const size_t element_bytes ){
+  const size_t block_bytes = global_program_context.iteration_order_block_elts * element_bytes;
+  switch( global_program_context.iteration_order_type ){
+    case iteration_order_random_order:
+    case iteration_order_feistel_order:
+      return CACHE_LINE_BYTES;
+    case iteration_order_strided_order:
+      return ( block_bytes >= CACHE_LINE_BYTES ) ? CACHE_LINE_BYTES : element_bytes;
+    case iteration_order_block_random_order:
+    case iteration_order_block_shuffle_order:
+    case iteration_order_page_random_order:
+      return ( block_bytes < CACHE_LINE_BYTES ) ? CACHE_LINE_BYTES : element_bytes;
+    default:
+      return element_bytes;
+  }
+}
+
+// \brief Model the bytes and flops per element of the kernel timed by a phase
+// A streaming model: every access moves its element (or its cache line, see
+// element_access_bytes) once, neighbors read by the stencil are assumed to be
+// cached, and write-allocate traffic is not counted. Indirect orders also read
+// their index. Only the stencil and the sum do floating point work; the sin of
+// init is not counted.
+// \param distributed_array distributed array object
+// \param phase phase_indirection, phase_init, phase_stencil or phase_sum
+// \return model of the kernel
+kernel_model_t model_kernel( const distributed_array* distributed_array, const phase_t phase ){
+  const size_t element_bytes = get_core_element_ops( distributed_array->element_type ).size;
+  const double access_bytes = element_access_bytes( element_bytes );
+  const double index_bytes = ( distributed_array->compact_indirection_arrays != NULL ) ? sizeof(uint32_t)
+                           : ( distributed_array->indirection_arrays != NULL )         ? sizeof(size_t) : 0;
+  // With -f, and with temporal tiling (-T), the sum is computed by the stencil
+  const bool stencil_sums = global_program_context.fuse_stencil_and_sum || distributed_array->tiled_level_sums != NULL;
+  // Note: the grid stencil is the maxmin operator of radius 1 along every dimension
+  const double update_flops = ( distributed_array->n_dims > 1 ) ? 15 : stencil_flops_per_update( global_program_context.stencil_radius );
+
+  kernel_model_t model = { 0.0, 0.0 };
+  switch( phase ){
+    case phase_indirection:
+      // Written once, and read back once more to compact it
+      if( index_bytes > 0 ) model.bytes = sizeof(size_t) + ( ( index_bytes < sizeof(size_t) ) ? sizeof(size_t) + index_bytes : 0 );
+      break;
+    case phase_init:
+      model.bytes = access_bytes + index_bytes;
+      break;
+    case phase_stencil:
+      model.bytes = 2 * access_bytes + index_bytes;
+      model.flops = update_flops + ( stencil_sums ? 1 : 0 );
+      break;
+    case phase_sum:
+      // The reproducible sum makes two passes, for the max magnitude and the sum
+      model.bytes = ( global_program_context.reproducible_sum ? 2 : 1 ) * ( access_bytes + index_bytes );
+      model.flops = ( global_program_context.reproducible_sum ? 2 : 1 );
+      break;
+    default:
+      break;
+  }
+  return model;
+}
+
+// \brief Print the achieved bandwidth, flop rate and arithmetic intensity of every kernel
+// Elements processed by each kernel on this rank, times its model (see
+// model_kernel), over the time of its phase. The stencil includes the end
+// fix-up, but not the halo wait. Rates are printed with their min/avg/max
+// across ranks, and with -v more, every rank prints its own. With the machine
+// probe (-b), bandwidths are also given as a percent of the rank's peak: the
+// gather's for orders that scatter the accesses, the triad's otherwise.
+// Note: collective, prints on the primary rank. Must be called before any run
+//       other than the iterations (the -R and -p comparisons).
+// \param distributed_array distributed array object, after the iterations
+void report_roofline( const distributed_array* distributed_array ){
+  #define roofline_kernel_count 4
+  const phase_t phases[roofline_kernel_count] = { phase_indirection, phase_init, phase_stencil, phase_sum };
+  const size_t iterations = global_program_context.iterations;
+  const size_t local_elts = distributed_array->local_elts;
+  const size_t elts[roofline_kernel_count] = {
+    ( distributed_array->feistel_permutations != NULL ) ? 0 : distributed_array->n_indirection_arrays * local_elts,
+    // Note: the prefetch sweep (-P sweep) initializes the array a second time
+    ( global_program_context.prefetch_sweep ? 2 : 1 ) * local_elts,
+    iterations * local_elts + distributed_array->redundant_updates,
+    // Note: with -f and -T, the sum is done by the stencil (see model_kernel)
+    ( global_program_context.fuse_stencil_and_sum || distributed_array->tiled_level_sums != NULL ) ? 0 : iterations * local_elts,
+  };
+  const double seconds[roofline_kernel_count] = {
+    global_phase_seconds[phase_indirection],
+    global_phase_seconds[phase_init],
+    global_phase_seconds[phase_stencil] + global_phase_seconds[phase_end_fixup],
+    global_phase_seconds[phase_sum],
+  };
+
+  const size_t element_bytes = get_core_element_ops( distributed_array->element_type ).size;
+  const bool probed = global_program_context.probe_elts > 0;
+  const double peak_gbytes_per_second = ( element_access_bytes( element_bytes ) > element_bytes ) ? global_machine_peak.gather_gbytes_per_second : global_machine_peak.triad_gbytes_per_second;
+
+  kernel_model_t models[roofline_kernel_count];
+  double gbytes_per_second[roofline_kernel_count], gflops_per_second[roofline_kernel_count], percent_of_peak[roofline_kernel_count];
+  for( int kernel = 0; kernel < roofline_kernel_count; ++kernel ){
+    models[kernel] = model_kernel( distributed_array, phases[kernel] );
+    // Note: kernels that did not run on this rank have no rate
+    gbytes_per_second[kernel] = ( seconds[kernel] > 0.0 ) ? elts[kernel] * models[kernel].bytes * 1e-9 / seconds[kernel] : 0.0;
+    gflops_per_second[kernel] = ( seconds[kernel] > 0.0 ) ? elts[kernel] * models[kernel].flops * 1e-9 / seconds[kernel] : 0.0;
+    percent_of_peak[kernel] = ( peak_gbytes_per_second > 0.0 ) ? 100.0 * gbytes_per_second[kernel] / peak_gbytes_per_second : 0.0;
+  }
+
+  double min_gbytes[roofline_kernel_count], max_gbytes[roofline_kernel_count], total_gbytes[roofline_kernel_count], total_gflops[roofline_kernel_count], total_percent[roofline_kernel_count];
+  MPI_Reduce( gbytes_per_second, min_gbytes,   roofline_kernel_count, MPI_DOUBLE, MPI_MIN, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( gbytes_per_second, max_gbytes,   roofline_kernel_count, MPI_DOUBLE, MPI_MAX, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( gbytes_per_second, total_gbytes, roofline_kernel_count, MPI_DOUBLE, MPI_SUM, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( gflops_per_second, total_gflops, roofline_kernel_count, MPI_DOUBLE, MPI_SUM, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( percent_of_peak,   total_percent, roofline_kernel_count, MPI_DOUBLE, MPI_SUM, global_program_context.primary_rank, global_program_context.comm );
+
+  if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
+    printf( "%-14s %10s %10s %10s %10s %10s %10s %10s", "Kernel", "bytes/elt", "flops/elt", "flops/byte", "min GB/s", "avg GB/s", "max GB/s", "avg GFLOP/s" );
+    if( probed ) printf( " %10s", "avg % peak" );
+    printf( "\n" );
+    for( int kernel = 0; kernel < roofline_kernel_count; ++kernel ){
+      const double intensity = ( models[kernel].bytes > 0.0 ) ? models[kernel].flops / models[kernel].bytes : 0.0;
+      printf( "%-14s %10.1f %10.1f %10.3f %10.3f %10.3f %10.3f %10.3f", phase_name( phases[kernel] ), models[kernel].bytes, models[kernel].flops, intensity, min_gbytes[kernel], total_gbytes[kernel] / global_program_context.n_ranks, max_gbytes[kernel], total_gflops[kernel] / global_program_context.n_ranks );
+      if( probed ) printf( " %10.1f", total_percent[kernel] / global_program_context.n_ranks );
+      printf( "\n" );
+    }
+  }
+  if( global_program_context.verbosity >= verbosity_more ){
+    for( int kernel = 0; kernel < roofline_kernel_count; ++kernel ){
+      printf( "Rank %d %s: %lu elements in %f s, %.3f GB/s, %.3f GFLOP/s", global_program_context.rank, phase_name( phases[kernel] ), elts[kernel], seconds[kernel], gbytes_per_second[kernel], gflops_per_second[kernel] );
+      if( probed ) printf( ", %.1f%% of peak", percent_of_peak[kernel] );
+      printf( "\n" );
+    }
+  }
+  #undef roofline_kernel_count
+}
+
+// \brief Print the hardware events counted in the stencil, sum and communication phases (-H)
+// Communication is the halo wait, the reduction and the -w barriers. Counts are
+// of all threads of a rank, including threads idling through the phase, and
+// printed as their avg across ranks (every rank's own with -v more). Events
+// unavailable on any rank are left out.
+// Note: collective, prints on the primary rank.
+void report_hw_counters( ){
+  #define hw_phase_group_count 3
+  const char* group_names[hw_phase_group_count] = { "stencil", "sum", "communication" };
+  const phase_t groups[hw_phase_group_count][3] = {
+    { phase_stencil,   phase_end_fixup, phase_count },
+    { phase_sum,       phase_count,     phase_count },
+    { phase_halo_wait, phase_reduce,    phase_barrier },
+  };
+
+  double counts[hw_phase_group_count][hw_counter_count] = { { 0.0 } };
+  for( int group = 0; group < hw_phase_group_count; ++group ){
+    for( int member = 0; member < 3 && groups[group][member] != phase_count; ++member ){
+      for( int counter = 0; counter < hw_counter_count; ++counter ){
+        counts[group][counter] += global_phase_hw_counts[groups[group][member]][counter];
+      }
+    }
+  }
+
+  int available[hw_counter_count], all_available[hw_counter_count];
+  for( int counter = 0; counter < hw_counter_count; ++counter ) available[counter] = global_hw_counter_available[counter];
+  double total_counts[hw_phase_group_count][hw_counter_count];
+  MPI_Reduce( available, all_available, hw_counter_count, MPI_INT, MPI_MIN, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( counts, total_counts, hw_phase_group_count * hw_counter_count, MPI_DOUBLE, MPI_SUM, global_program_context.primary_rank, global_program_context.comm );
+
+  if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
+    printf( "%-14s", "Phase" );
+    for( int counter = 0; counter < hw_counter_count; ++counter ) printf( " %14s", hw_counter_name( counter ) );
+    printf( " %8s\n", "IPC" );
+    for( int group = 0; group < hw_phase_group_count; ++group ){
+      printf( "%-14s", group_names[group] );
+      for( int counter = 0; counter < hw_counter_count; ++counter ){
+        if( all_available[counter] ) printf( " %14.4g", total_counts[group][counter] / global_program_context.n_ranks );
+        else                         printf( " %14s", "-" );
+      }
+      const double cycles = total_counts[group][hw_counter_cycles];
+      if( all_available[hw_counter_cycles] && all_available[hw_counter_instructions] && cycles > 0.0 ) printf( " %8.3f\n", total_counts[group][hw_counter_instructions] / cycles );
+      else                                                                                            printf( " %8s\n", "-" );
+    }
+  }
+  if( global_program_context.verbosity >= verbosity_more ){
+    for( int group = 0; group < hw_phase_group_count; ++group ){
+      printf( "Rank %d %s:", global_program_context.rank, group_names[group] );
+      for( int counter = 0; counter < hw_counter_count; ++counter ){
+        if( global_hw_counter_available[counter] ) printf( " %.0f %s", counts[group][counter], hw_counter_name( counter ) );
+      }
+      printf( "\n" );
+    }
+  }
+  #undef hw_phase_group_count
+}
+
+// \brief Print the work counters of this rank's threads
+// Busy is the time a thread spent in its iterations, wait the time it spent at
+// the loops' barriers. The imbalance of the rank is its threads' max busy over
+// their avg busy: 1 when the schedule balances the threads perfectly.
+// Note: every rank prints its own line, and its threads' lines with -v more.
+void report_thread_work_counters( ){
+  const int n_threads = global_program_context.omp_num_threads;
+  size_t total_elts = 0;
+  double total_busy_seconds = 0.0, max_busy_seconds = 0.0, total_wait_seconds = 0.0;
+  for( int thread = 0; thread < n_threads; ++thread ){
+    const thread_work_counters_t* counters = &global_thread_work_counters[thread];
+    total_elts += counters->elts;
+    total_busy_seconds += counters->busy_seconds;
+    max_busy_seconds = max2( max_busy_seconds, counters->busy_seconds );
+    total_wait_seconds += counters->wait_seconds;
+  }
+  const double avg_busy_seconds = total_busy_seconds / n_threads;
+
+  if( global_program_context.verbosity >= verbosity_normal ){
+    printf( "Rank %d threads: %lu elements, %f s busy, %f s waiting (avg per thread), busy imbalance %.3f\n", global_program_context.rank, total_elts, avg_busy_seconds, total_wait_seconds / n_threads, ( avg_busy_seconds > 0.0 ) ? max_busy_seconds / avg_busy_seconds : 1.0 );
+  }
+  if( global_program_context.verbosity >= verbosity_more ){
+    for( int thread = 0; thread < n_threads; ++thread ){
+      const thread_work_counters_t* counters = &global_thread_work_counters[thread];
+      printf( "Rank %d thread %d: %lu elements, %f s busy, %f s waiting\n", global_program_context.rank, thread, counters->elts, counters->busy_seconds, counters->wait_seconds );
+    }
+  }
+}
 
 // \brief Main
 // \param argc number of argument strings (length of argv)
@@ -923,46 +5183,156 @@ double sum_distributed_array( distributed_array* distributed_array ){
 // \return exit status
 int main( int argc, char** argv ){
   // Initialize program
+  // Note: timed with omp_get_wtime, as MPI_Wtime is only available after MPI_Init
+  const double init_start_time = omp_get_wtime();
   program_init( argc, argv );
+  global_phase_seconds[phase_program_init] += omp_get_wtime() - init_start_time;
 
   // Print information about this execution
   if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
     printf( "Performing %d iterations of stencilize and sum over a distributed array with %d elements.\n", global_program_context.iterations, global_program_context.N );
   }
 
+  // Print the stencil operator, and its arithmetic per update
+  if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank && global_program_context.n_dims == 1 ){
+    printf( "Stencil operator \"%s\": %s, %lu flops per update (intensity %d)\n", stencil_operators[global_program_context.stencil_operator_type].name, stencil_operators[global_program_context.stencil_operator_type].description, stencil_flops_per_update( global_program_context.stencil_radius ), global_program_context.stencil_intensity );
+  }
+
   // Allocate distributed array
-  distributed_array array = allocate_distributed_array( global_program_context.N, global_program_context.distribution_type );
+  // Note: the indirection setup is timed as its own phase, inside
+  double start_time = MPI_Wtime();
+  const double indirection_seconds = global_phase_seconds[phase_indirection];
+  distributed_array array = allocate_distributed_array( global_program_context.N, global_program_context.distribution_type, global_program_context.element_type );
+  global_phase_seconds[phase_allocate] += MPI_Wtime() - start_time - ( global_phase_seconds[phase_indirection] - indirection_seconds );
 
   // Print information about ranks and array
   if( global_program_context.verbosity >= verbosity_normal ){
     printf( "Rank %d/%d with %d OpenMP threads owns %lu of %lu elements\n", global_program_context.rank, global_program_context.n_ranks, global_program_context.omp_num_threads, array.local_elts, array.total_elts  );
   }
 
+  // Print the grid blocks, and how much of them is exchanged
+  if( array.n_dims > 1 && global_program_context.verbosity >= verbosity_normal ){
+    size_t halo_elts = 0;
+    for( int dim = 3 - array.n_dims; dim < 3; ++dim ){
+      for( int side = 0; side < 2; ++side ){
+        if( array.grid_neighbors[dim][side] != MPI_PROC_NULL ) halo_elts += array.local_elts / array.grid_local_dims[dim];
+      }
+    }
+    if( array.n_dims == 3 ){
+      printf( "Rank %d owns a %lu x %lu x %lu block at (%lu, %lu, %lu)", global_program_context.rank, array.grid_local_dims[0], array.grid_local_dims[1], array.grid_local_dims[2], array.grid_offsets[0], array.grid_offsets[1], array.grid_offsets[2] );
+    } else {
+      printf( "Rank %d owns a %lu x %lu block at (%lu, %lu)", global_program_context.rank, array.grid_local_dims[1], array.grid_local_dims[2], array.grid_offsets[1], array.grid_offsets[2] );
+    }
+    printf( ", receives %lu halo elements per stencil (surface to volume %f)\n", halo_elts, ((double) halo_elts) / array.local_elts );
+  }
+
   // Initialize distributed array with arbitrary values
+  start_time = start_phase( phase_init );
   init_distributed_array( &array );
+  end_phase( phase_init, start_time );
+
+  // Pick the prefetch distance, and start over from the initial values
+  if( global_program_context.prefetch_sweep ){
+    sweep_prefetch_distance( &array );
+    start_time = start_phase( phase_init );
+    init_distributed_array( &array );
+    end_phase( phase_init, start_time );
+  }
 
-  double mean_sum = 0.0;
-  for( int iteration = 0; iteration < global_program_context.iterations; ++iteration ){
-    // "Stencilize" distributed array
-    in_place_stencilize_distributed_array( &array );
+  // Measure the bandwidth the kernels' rates are compared against
+  if( global_program_context.probe_elts > 0 ){
+    probe_machine_peak( );
+  }
 
-    // sum distributed array
-    double iteration_sum = sum_distributed_array( &array );
-    mean_sum += iteration_sum / global_program_context.iterations;
+  // Only the iterations are counted
+  reset_thread_work_counters( );
 
-    // Print reduction value
-    // Note: the expression (true | (int)sum) is a trick to force the not optimize
-    // the reduce_distributed_array call to be under this conditional.
-    if( global_program_context.verbosity >= verbosity_more && (true | (int) iteration_sum) && global_program_context.rank == global_program_context.primary_rank ){
-      printf( "Iteration %d sum: %f\n", iteration, iteration_sum );
+  const size_t allocations_before_iterations = global_allocation_count;
+  const double iterations_start_time = MPI_Wtime();
+  const double mean_sum = iterate_distributed_array( &array, true );
+  const double iterations_seconds = MPI_Wtime() - iterations_start_time;
+
+  // Print time spent reducing
+  double max_reduction_seconds, total_reduction_seconds;
+  MPI_Reduce( &global_phase_seconds[phase_reduce], &max_reduction_seconds,   1, MPI_DOUBLE, MPI_MAX, global_program_context.primary_rank, global_program_context.comm );
+  MPI_Reduce( &global_phase_seconds[phase_reduce], &total_reduction_seconds, 1, MPI_DOUBLE, MPI_SUM, global_program_context.primary_rank, global_program_context.comm );
+  if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
+    printf( "Time in \"%s\" reduction: %f s average, %f s max across ranks\n", global_program_context.reproducible_sum ? "reproducible" : reduction_name( global_program_context.reduction_type ), total_reduction_seconds / global_program_context.n_ranks, max_reduction_seconds );
+  }
+
+  // Print time spent in every phase
+  // Note: before the extra sums of -R and the double reference run of -p
+  report_phase_seconds( );
+
+  // Print the achieved rates of every kernel against its bytes and flops model
+  report_roofline( &array );
+
+  // Print the hardware events of the main phases
+  if( global_program_context.hw_counters ){
+    report_hw_counters( );
+  }
+
+  // Print temporal blocking savings and costs
+  if( array.ghost_elts > 0 ){
+    unsigned long local_counts[3] = { array.halo_messages_sent, array.halo_messages_saved, array.redundant_updates };
+    unsigned long total_counts[3];
+    MPI_Reduce( local_counts, total_counts, 3, MPI_UNSIGNED_LONG, MPI_SUM, global_program_context.primary_rank, global_program_context.comm );
+    if( global_program_context.verbosity >= verbosity_normal && global_program_context.rank == global_program_context.primary_rank ){
+      printf( "Temporal blocking depth %d: %lu halo messages sent, %lu saved, %lu redundant updates (%lu redundant flops)\n", global_program_context.temporal_block_depth, total_counts[0], total_counts[1], total_counts[2], total_counts[2] * stencil_flops_per_update( global_program_context.stencil_radius ) );
+    }
+  }
+
+  // Print steady-state allocations
+  if( global_program_context.verbosity >= verbosity_more && global_program_context.iterations > 0 ){
+    size_t iteration_allocations = global_allocation_count - allocations_before_iterations;
+    printf( "Rank %d made %lu heap allocations over %d iterations (%f per iteration)\n", global_program_context.rank, iteration_allocations, global_program_context.iterations, ((double) iteration_allocations) / global_program_context.iterations );
+  }
+
+  // Print the thread weights the weighted schedule converged to
+  if( global_program_context.verbosity >= verbosity_more && global_program_context.loop_schedule_type == loop_schedule_weighted ){
+    printf( "Rank %d thread weights:", global_program_context.rank );
+    for( int thread = 0; thread < global_program_context.omp_num_threads; ++thread ){
+      printf( " %.3f", global_loop_schedule_threads[thread].weight );
     }
+    printf( "\n" );
   }
 
+  // Print how the loops' work and time were split across threads
+  report_thread_work_counters( );
+
   // Print mean sum
   if( global_program_context.verbosity >= verbosity_less && global_program_context.rank == global_program_context.primary_rank ){
     printf( "Mean sum: %f\n", mean_sum );
   }
 
+  // Reproducible sums can be compared bit for bit, and their cost against the plain sum
+  if( global_program_context.reproducible_sum ){
+    if( global_program_context.verbosity >= verbosity_less && global_program_context.rank == global_program_context.primary_rank ){
+      printf( "Mean sum (exact bits): %a\n", mean_sum );
+    }
+    report_reproducible_sum_overhead( &array, max2( global_program_context.iterations, 1 ) );
+  }
+
+  // Repeat the run in double, to weigh the bandwidth saved against the accuracy lost
+  if( global_program_context.element_type != element_double ){
+    distributed_array reference = allocate_distributed_array( global_program_context.N, global_program_context.distribution_type, element_double );
+    init_distributed_array( &reference );
+    const double reference_start_time = MPI_Wtime();
+    const double reference_mean_sum = iterate_distributed_array( &reference, false );
+    const double reference_seconds = MPI_Wtime() - reference_start_time;
+    free_distributed_array( &reference );
+
+    double max_seconds[2];
+    const double local_seconds[2] = { iterations_seconds, reference_seconds };
+    MPI_Reduce( local_seconds, max_seconds, 2, MPI_DOUBLE, MPI_MAX, global_program_context.primary_rank, global_program_context.comm );
+
+    if( global_program_context.verbosity >= verbosity_less && global_program_context.rank == global_program_context.primary_rank ){
+      const double deviation = mean_sum - reference_mean_sum;
+      printf( "Mean sum in double: %f, deviation in %s: %e (relative %e)\n", reference_mean_sum, element_type_name( global_program_context.element_type ), deviation, fabs( deviation ) / fabs( reference_mean_sum ) );
+      printf( "Iterations took %f s in %s (%lu bytes per element), %f s in double (max across ranks)\n", max_seconds[0], element_type_name( global_program_context.element_type ), get_core_element_ops( global_program_context.element_type ).size, max_seconds[1] );
+    }
+  }
+
   // Free distributed array
   free_distributed_array( &array );
 